@@ -0,0 +1,54 @@
+/**
+ * \file Block.hpp
+ *
+ * Implements a block for use in an unrolled linked list. Each block
+ * holds up to BLOCK_CAPACITY pointers to elements, in order, together
+ * with how many it holds, so a list of n elements has about n /
+ * BLOCK_CAPACITY blocks to chase instead of n nodes. The list itself
+ * caches its total size.
+ */
+
+#ifndef BLOCK_HPP
+#define BLOCK_HPP
+
+#include "Cell.hpp"
+
+/**
+ * \brief Maximum number of elements in a block: 16 pointers fill two
+ * cache lines.
+ */
+const int BLOCK_CAPACITY = 16;
+
+/**
+ * \class Block
+ * \brief A block within a doubly linked list of blocks.
+ */
+struct Block {
+  int count_m;
+  Cell* elems_m[BLOCK_CAPACITY];
+  Block* prev_m;
+  Block* next_m;
+};
+
+/**
+ * \class UnrolledList
+ * \brief An unrolled linked list: its first and last blocks, and its
+ * number of elements.
+ */
+struct UnrolledList {
+  Block* head_m;
+  Block* tail_m;
+  int size_m;
+};
+
+/**
+ * \class UnrolledPos
+ * \brief A position in an unrolled list: an element's block and its
+ * index there, or a NULL block for the position past the end.
+ */
+struct UnrolledPos {
+  Block* block_m;
+  int index_m;
+};
+
+#endif // BLOCK_HPP
@@ -0,0 +1,128 @@
+/**
+ * \file bench_list.cpp
+ *
+ * Benchmark of the unrolled list against the Node chain, both holding
+ * 1M int cells: building the list, list_size, list_ith at random
+ * positions, a full traversal, and inserting then erasing values in
+ * the middle.
+ *
+ * Usage: bench_list [number of elements, default 1000000]
+ */
+
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include "linkedlist.hpp"
+#include "unrolledlist.hpp"
+
+using namespace std;
+
+/**
+ * \brief Gets the processor time used so far.
+ * \return The time in milliseconds.
+ */
+double now_ms()
+{
+  return 1000.0 * clock() / CLOCKS_PER_SEC;
+}
+
+/**
+ * \brief Prints a table row: one operation timed on both lists.
+ */
+void print_row(const char* name, int count, double node_ms, double unrolled_ms)
+{
+  cout << left << setw(18) << name << right << setw(8) << count
+       << fixed << setprecision(1)
+       << setw(12) << node_ms << setw(14) << unrolled_ms << endl;
+}
+
+int main(int argc, char** argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  const int sizes = 100;
+  const int lookups = 200;
+  const int edits = 100;
+  long long checksum = 0;
+  double start, node_ms, unrolled_ms;
+
+  cout << left << setw(18) << "operation" << right << setw(8) << "count"
+       << setw(12) << "Node ms" << setw(14) << "unrolled ms" << endl;
+
+  // Build: the Node chain grows at the head, which is O(1) there.
+  start = now_ms();
+  Node* head = make_node(make_int(n - 1), NULL);
+  for(int i = n - 2; i >= 0; --i)
+    list_insert_int(head, head, i);
+  node_ms = now_ms() - start;
+
+  start = now_ms();
+  UnrolledList* list = make_unrolled_list();
+  for(int i = 0; i < n; ++i)
+    list_insert_int(list, list_end(list), i);
+  unrolled_ms = now_ms() - start;
+  print_row("build", n, node_ms, unrolled_ms);
+
+  start = now_ms();
+  for(int i = 0; i < sizes; ++i)
+    checksum += list_size(head);
+  node_ms = now_ms() - start;
+
+  start = now_ms();
+  for(int i = 0; i < sizes; ++i)
+    checksum += list_size(list);
+  unrolled_ms = now_ms() - start;
+  print_row("list_size", sizes, node_ms, unrolled_ms);
+
+  srand(42);
+  int* positions = new int[lookups];
+  for(int i = 0; i < lookups; ++i)
+    positions[i] = rand() % n;
+
+  start = now_ms();
+  for(int i = 0; i < lookups; ++i)
+    checksum += get_int(list_ith(head, positions[i]));
+  node_ms = now_ms() - start;
+
+  start = now_ms();
+  for(int i = 0; i < lookups; ++i)
+    checksum -= get_int(list_ith(list, positions[i]));
+  unrolled_ms = now_ms() - start;
+  print_row("list_ith", lookups, node_ms, unrolled_ms);
+
+  start = now_ms();
+  for(const Node* curr = head; curr != NULL; curr = get_next(curr))
+    checksum += get_int(get_elem(curr));
+  node_ms = now_ms() - start;
+
+  start = now_ms();
+  for(UnrolledPos curr = list_begin(list); !pos_endp(curr); curr = get_next(curr))
+    checksum -= get_int(get_elem(curr));
+  unrolled_ms = now_ms() - start;
+  print_row("traverse", n, node_ms, unrolled_ms);
+
+  // Insert before, then erase, the value at a random position.
+  start = now_ms();
+  for(int i = 0; i < edits; ++i){
+    Node* pos = head;
+    for(int j = positions[i]; j > 0; --j)
+      pos = get_next(pos);
+    Node* inserted = list_insert_int(head, pos, -1);
+    list_erase(head, inserted);
+  }
+  node_ms = now_ms() - start;
+
+  start = now_ms();
+  for(int i = 0; i < edits; ++i){
+    UnrolledPos inserted = list_insert_int(list, list_ith_pos(list, positions[i]), -1);
+    list_erase(list, inserted);
+  }
+  unrolled_ms = now_ms() - start;
+  print_row("insert + erase", edits, node_ms, unrolled_ms);
+
+  cout << "(checksum " << checksum << ", sizes " << list_size(head)
+       << " " << list_size(list) << ")" << endl;
+
+  delete[] positions;
+  return EXIT_SUCCESS;
+}
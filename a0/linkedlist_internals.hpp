@@ -12,6 +12,8 @@
 #include "Node.hpp"
 #include "Cell.hpp"
 //#include <string>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 /**
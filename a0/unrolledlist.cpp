@@ -0,0 +1,148 @@
+#include "unrolledlist.hpp"
+
+int list_size(const UnrolledList* l) {
+  return l->size_m;
+}
+
+Cell* list_ith(const UnrolledList* l, unsigned int i) {
+  UnrolledPos pos = list_ith_pos(l, i);
+  if(pos_endp(pos)){
+    std::cerr << "Error at list_ith(const UnrolledList* l, unsigned int i)\n";
+    std::cerr << "Error: Given index i is out of bounds.\n";
+    exit(1);
+  }
+  return get_elem(pos);
+}
+
+UnrolledPos list_ith_pos(const UnrolledList* l, unsigned int i) {
+  // Skip whole blocks by their counts, then index into one.
+  for(Block* b = l->head_m; b != NULL; b = get_next_block(b)){
+    if(i < (unsigned int)b->count_m)
+      return make_pos(b, i);
+    i -= b->count_m;
+  }
+  return list_end(l);
+}
+
+/**
+ * \brief Unlink the block b from the list l and free it.
+ */
+static void unlink_block(UnrolledList* l, Block* b) {
+  if(b->prev_m != NULL)
+    b->prev_m->next_m = b->next_m;
+  else
+    l->head_m = b->next_m;
+
+  if(b->next_m != NULL)
+    b->next_m->prev_m = b->prev_m;
+  else
+    l->tail_m = b->prev_m;
+
+  free(b);
+}
+
+/**
+ * \brief Link a new, empty block into the list l after the block b.
+ * \return Pointer to the new block
+ */
+static Block* insert_block_after(UnrolledList* l, Block* b) {
+  Block* next = make_block(b, b->next_m);
+  if(b->next_m != NULL)
+    b->next_m->prev_m = next;
+  else
+    l->tail_m = next;
+  b->next_m = next;
+  return next;
+}
+
+UnrolledPos list_erase(UnrolledList* l, UnrolledPos pos) {
+  if(l == NULL || pos_endp(pos)){
+    std::cerr << "Error at list_erase(UnrolledList* l, UnrolledPos pos)\n";
+    std::cerr << "Error: List l was NULL and/or pos was the end.\n";
+    exit(1);
+  }
+
+  Block* b = pos.block_m;
+  int i = pos.index_m;
+
+  free(b->elems_m[i]);
+  memmove(b->elems_m + i, b->elems_m + i + 1, (b->count_m - i - 1) * sizeof(Cell*));
+  --b->count_m;
+  --l->size_m;
+
+  if(b->count_m == 0){
+    Block* next = b->next_m;
+    unlink_block(l, b);
+    return make_pos(next, 0);
+  }
+
+  // Keep blocks at least half full: take in the next block if it fits.
+  Block* next = b->next_m;
+  if(b->count_m < BLOCK_CAPACITY / 2 && next != NULL
+     && b->count_m + next->count_m <= BLOCK_CAPACITY){
+    memcpy(b->elems_m + b->count_m, next->elems_m, next->count_m * sizeof(Cell*));
+    b->count_m += next->count_m;
+    unlink_block(l, next);
+  }
+
+  if(i < b->count_m)
+    return make_pos(b, i);
+  return make_pos(b->next_m, 0);
+}
+
+UnrolledPos list_insert(UnrolledList* l, UnrolledPos pos, Cell* c) {
+  if(l == NULL){
+    std::cerr << "Error at list_insert(UnrolledList* l, UnrolledPos pos, Cell* c)\n";
+    std::cerr << "Error: Given list l is NULL.\n";
+    exit(1);
+  }
+
+  Block* b = pos.block_m;
+  int i = pos.index_m;
+
+  // Inserting before the end appends to the last block.
+  if(b == NULL){
+    if(l->tail_m == NULL)
+      l->head_m = l->tail_m = make_block(NULL, NULL);
+    b = l->tail_m;
+    i = b->count_m;
+  }
+
+  if(b->count_m == BLOCK_CAPACITY){
+    if(i == BLOCK_CAPACITY){
+      // Appending to a full block starts the next one, so a list built
+      // in order has full blocks.
+      b = insert_block_after(l, b);
+      i = 0;
+    } else{
+      // Otherwise split the block, moving its upper half to a new block.
+      int half = BLOCK_CAPACITY / 2;
+      Block* next = insert_block_after(l, b);
+      memcpy(next->elems_m, b->elems_m + half, (BLOCK_CAPACITY - half) * sizeof(Cell*));
+      next->count_m = BLOCK_CAPACITY - half;
+      b->count_m = half;
+      if(i > half){
+        b = next;
+        i -= half;
+      }
+    }
+  }
+
+  memmove(b->elems_m + i + 1, b->elems_m + i, (b->count_m - i) * sizeof(Cell*));
+  b->elems_m[i] = c;
+  ++b->count_m;
+  ++l->size_m;
+  return make_pos(b, i);
+}
+
+UnrolledPos list_insert_int(UnrolledList* l, UnrolledPos pos, const int value) {
+  return list_insert(l, pos, make_int(value));
+}
+
+UnrolledPos list_insert_double(UnrolledList* l, UnrolledPos pos, const double value) {
+  return list_insert(l, pos, make_double(value));
+}
+
+UnrolledPos list_insert_symbol(UnrolledList* l, UnrolledPos pos, const char* value) {
+  return list_insert(l, pos, make_symbol(value));
+}
@@ -0,0 +1,66 @@
+/**
+ * \file unrolledlist.hpp
+ *
+ * The sequence ADT of linkedlist.hpp over an unrolled linked list,
+ * without using member functions: the same functions, taking the list
+ * and positions in it instead of a head node and nodes. Elements are
+ * kept in blocks of up to BLOCK_CAPACITY, so list_size is O(1),
+ * list_ith is O(n / BLOCK_CAPACITY), and an insert only mallocs when a
+ * block fills up.
+ */
+
+#ifndef UNROLLEDLIST_HPP
+#define UNROLLEDLIST_HPP
+
+#include "unrolledlist_internals.hpp"
+
+/**
+ * \brief Size of the list l, cached
+ * \return List size
+ */
+int list_size(const UnrolledList* l);
+
+/**
+ * \brief Value at the position i (starting from 0), skipping whole blocks
+ * \return Pointer to the value at position i in the list
+ */
+Cell* list_ith(const UnrolledList* l, unsigned int i);
+
+/**
+ * \brief Position of the value at i (starting from 0), or the end if i is
+ * the size of the list
+ * \return The position of the value at i
+ */
+UnrolledPos list_ith_pos(const UnrolledList* l, unsigned int i);
+
+/**
+ * \brief Erase the value at position 'pos' of the list l
+ * \return The position of the value after pos
+ */
+UnrolledPos list_erase(UnrolledList* l, UnrolledPos pos);
+
+/**
+ * \brief Insert the value before the position 'pos' of the list l
+ * \return The position of the inserted value
+ */
+UnrolledPos list_insert(UnrolledList* l, UnrolledPos pos, Cell* c);
+
+/**
+ * \brief Insert an int before the position 'pos' of the list l
+ * \return The position of the inserted value
+ */
+UnrolledPos list_insert_int(UnrolledList* l, UnrolledPos pos, const int value);
+
+/**
+ * \brief Insert a double before the position 'pos' of the list l
+ * \return The position of the inserted value
+ */
+UnrolledPos list_insert_double(UnrolledList* l, UnrolledPos pos, const double value);
+
+/**
+ * \brief Insert a symbol before the position 'pos' of the list l
+ * \return The position of the inserted value
+ */
+UnrolledPos list_insert_symbol(UnrolledList* l, UnrolledPos pos, const char* value);
+
+#endif // UNROLLEDLIST_HPP
@@ -0,0 +1,140 @@
+/**
+ * \file unrolledlist_internals.hpp
+ *
+ * Encapsulates an abstract interface layer for an unrolled list ADT,
+ * without using member functions: making lists and blocks, and walking
+ * positions.
+ */
+
+#ifndef UNROLLEDLIST_INTERNALS_HPP
+#define UNROLLEDLIST_INTERNALS_HPP
+
+#include "Block.hpp"
+#include "linkedlist_internals.hpp"
+
+/**
+ * \brief Make an empty unrolled list.
+ */
+inline UnrolledList* make_unrolled_list()
+{
+  UnrolledList* list = (UnrolledList*)malloc(sizeof(struct UnrolledList));
+  list->head_m = NULL;
+  list->tail_m = NULL;
+  list->size_m = 0;
+  return list;
+}
+
+/**
+ * \brief Make an empty block.
+ * \param my_prev Pointer to the previous block.
+ * \param my_next Pointer to the next block.
+ */
+inline Block* make_block(Block* my_prev, Block* my_next)
+{
+  Block* block = (Block*)malloc(sizeof(struct Block));
+  block->count_m = 0;
+  block->prev_m = my_prev;
+  block->next_m = my_next;
+  return block;
+}
+
+/**
+ * \brief Accessor.
+ * \return The next block after b.
+ */
+inline Block* get_next_block(const Block* b)
+{
+  return b != NULL ? b->next_m : NULL;
+}
+
+/**
+ * \brief Make a position.
+ * \param my_block Pointer to the block of the element, NULL for the end.
+ * \param my_index Index of the element in the block.
+ */
+inline UnrolledPos make_pos(Block* my_block, int my_index)
+{
+  UnrolledPos pos;
+  pos.block_m = my_block;
+  pos.index_m = my_index;
+  return pos;
+}
+
+/**
+ * \brief Accessor.
+ * \return The position of the first element of l (the end if l is empty).
+ */
+inline UnrolledPos list_begin(const UnrolledList* l)
+{
+  return make_pos(l->head_m, 0);
+}
+
+/**
+ * \brief Accessor.
+ * \return The position past the last element of l; the same for
+ * every list.
+ */
+inline UnrolledPos list_end(const UnrolledList*)
+{
+  return make_pos(NULL, 0);
+}
+
+/**
+ * \brief Check if pos is the position past the last element.
+ * \return True iff pos is the end.
+ */
+inline bool pos_endp(UnrolledPos pos)
+{
+  return pos.block_m == NULL;
+}
+
+/**
+ * \brief Accessor.
+ * \return The elem pointer at the position pos, NULL at the end.
+ */
+inline Cell* get_elem(UnrolledPos pos)
+{
+  return pos.block_m != NULL ? pos.block_m->elems_m[pos.index_m] : NULL;
+}
+
+/**
+ * \brief Accessor.
+ * \return The position after pos, moving to the next block after the
+ * last element of a block.
+ */
+inline UnrolledPos get_next(UnrolledPos pos)
+{
+  if(pos.block_m == NULL)
+    return pos;
+  if(pos.index_m + 1 < pos.block_m->count_m)
+    return make_pos(pos.block_m, pos.index_m + 1);
+  return make_pos(pos.block_m->next_m, 0);
+}
+
+/**
+ * \brief Print the unrolled list l in parentheses.
+ * \param os The output stream to print to.
+ * \param l The unrolled list to be printed.
+ */
+inline std::ostream& operator<<(std::ostream& os, const UnrolledList& l)
+{
+  os << "(";
+  for(UnrolledPos curr = list_begin(&l); !pos_endp(curr); ){
+    Cell* elem = get_elem(curr);
+    if(intp(elem))
+      os << get_int(elem);
+    else if(doublep(elem))
+      os << get_double(elem);
+    else if(symbolp(elem))
+      os << get_symbol(elem);
+
+    curr = get_next(curr);
+    if(!pos_endp(curr))
+      os << " ";
+  }
+
+  os << ")";
+  return os;
+}
+
+#endif // UNROLLEDLIST_INTERNALS_HPP
@@ -1,52 +1,37 @@
 #include "Cell.hpp"
 #include "eval.hpp"
 #include <cstring>
+#include <new>
 #include "hashtablemap.hpp"
 
 using namespace std;
 
 
-typedef hashtablemap<string, Cell*> hashmap;
-
 Cell* const nil = 0;
 extern vector< hashmap > stack_frame;
 
 ////////////////////////////////////////////////////////////////////////////////
 // REGION class Cell
 
-Cell::~Cell()
+Cell::Cell(const TypeTag tag, const CdrCode cdr_code)
+  : tag_m(tag), cdr_code_m(cdr_code), mark_m(false)
 {
   // Purposely Empty.
 }
 
-bool Cell::is_int() const
-{
-  return false;
-}
-
-bool Cell::is_double() const
+void* Cell::operator new(size_t size)
 {
-  return false;
+  return heap_allocate(size);
 }
 
-bool Cell::is_symbol() const
+void Cell::operator delete(void* p)
 {
-  return false;
+  heap_release(p);
 }
 
-bool Cell::is_cons() const
-{
-  return false;
-}
-
-bool Cell::is_operator() const
-{
-  return false;
-}
-
-bool Cell::is_procedure() const
+Cell::~Cell()
 {
-  return false;
+  // Purposely Empty.
 }
 
 bool Cell::is_nonzerovalue() const
@@ -123,30 +108,16 @@ Cell* Cell::apply(Cell* const args) const
 // REGION class IntCell
 
 IntCell::IntCell(const int i)
+  : Cell(type_int)
 {
   int_m = i;
 }
 
-bool IntCell::is_int() const
-{
-  return true;
-}
-
 bool IntCell::is_nonzerovalue() const
 {
   return get_value() != 0 ? true : false;
 }
 
-int IntCell::get_int() const
-{
-  return int_m;
-}
-
-double IntCell::get_value() const
-{
-  return (double) get_int();
-}
-
 void IntCell::print(ostream& os) const
 {
   os << get_int();
@@ -159,7 +130,8 @@ Cell* IntCell::clone() const
 
 Cell* IntCell::eval() const
 {
-  return clone();
+  // Cells are immutable, so the value itself can be shared.
+  return const_cast<IntCell*>(this);
 }
 
 // ENDREGION class IntCell
@@ -170,30 +142,16 @@ Cell* IntCell::eval() const
 // REGION class DoubleCell
 
 DoubleCell::DoubleCell(const double d)
+  : Cell(type_double)
 {
   double_m = d;
 }
 
-bool DoubleCell::is_double() const
-{
-  return true;
-}
-
 bool DoubleCell::is_nonzerovalue() const
 {
   return get_value() != 0 ? true : false;
 }
 
-double DoubleCell::get_double() const
-{
-  return double_m;
-}
-
-double DoubleCell::get_value() const
-{
-  return get_double();
-}
-
 void DoubleCell::print(ostream& os) const
 {
   os << fixed << setprecision(5);
@@ -207,7 +165,8 @@ Cell* DoubleCell::clone() const
 
 Cell* DoubleCell::eval() const
 {
-  return clone();
+  // Cells are immutable, so the value itself can be shared.
+  return const_cast<DoubleCell*>(this);
 }
 
 // ENDREGION class DoubleCell
@@ -218,20 +177,26 @@ Cell* DoubleCell::eval() const
 // REGION class SymbolCell
 
 SymbolCell::SymbolCell(const char* const s)
+  : Cell(type_symbol)
 {
-  char* str = new char();
+  heap_account_bytes(this, strlen(s) + 1);
+  char* str = new char[strlen(s) + 1];
   strcpy(str, s);
   symbol_m = str;
 }
 
-SymbolCell::~SymbolCell()
+SymbolCell::SymbolCell(const char* const s, const TypeTag tag)
+  : Cell(tag)
 {
-  delete [] symbol_m;
+  heap_account_bytes(this, strlen(s) + 1);
+  char* str = new char[strlen(s) + 1];
+  strcpy(str, s);
+  symbol_m = str;
 }
 
-bool SymbolCell::is_symbol() const
+SymbolCell::~SymbolCell()
 {
-  return true;
+  delete [] symbol_m;
 }
 
 bool SymbolCell::is_nonzerovalue() const
@@ -240,11 +205,6 @@ bool SymbolCell::is_nonzerovalue() const
   return ((string)get_symbol()).empty() ? false : true;
 }
 
-char* SymbolCell::get_symbol() const
-{
-  return symbol_m;
-}
-
 void SymbolCell::print(ostream& os) const
 {
   os << get_symbol();
@@ -255,33 +215,54 @@ Cell* SymbolCell::clone() const
   return new SymbolCell(get_symbol());
 }
 
+/**
+ * \brief Gets the shared operator cell of an operation.
+ * Each operator cell is made once and kept alive as a heap root.
+ * \param operation The operation.
+ * \param name The operator name.
+ * \return The operator cell.
+ */
+static Cell* operator_cell(const Operation operation, const char* const name)
+{
+  static vector<Cell*> operator_cells;
+
+  if (operation >= (int) operator_cells.size()) {
+    operator_cells.resize(operation + 1, nil);
+  }
+  if (nullp(operator_cells[operation])) {
+    operator_cells[operation] = make_operator(name);
+    heap_add_root(operator_cells[operation]);
+  }
+
+  return operator_cells[operation];
+}
+
 Cell* SymbolCell::eval() const
 {
   string trace_prefix = "SymbolCell::eval()";
 
-  Operation operation = get_operation((string) get_symbol());
+  Operation operation = get_operation(get_symbol());
   if (operation != undefined_opr) {
     // if it's a defined operation.
-    return new OperatorCell(get_symbol());    
+    return operator_cell(operation, get_symbol());
   }
   
   // Check if symbol was a defined symbol.
-  //  Uses mapped_type& map::at(const key_type& k);
-  //    Returns a reference to the mapped value of the element identified with key k;
-  //    Function throws out_of_range exception if k is not found;
+  //  Looks the name up as a const char*, so no string is built
+  //    (and no exception thrown) for the frames that miss.
   try {
-    Cell* value = nil;
+    const char* name = get_symbol();
     vector< hashmap >::reverse_iterator rit = stack_frame.rbegin();
 
     while (rit != stack_frame.rend()) { 
-      try {
-        // Uses *rit to dereference to the map in the vector.
-	value = (*rit).at((string) get_symbol());
-        return clone_cell(value);
-      } catch (out_of_range&) {
-        // Moves reversed_iterator to a lower stack_frame.
-	++rit;
+      // Uses *rit to dereference to the map in the vector.
+      hashmap::iterator it = (*rit).find(name);
+      if (it != (*rit).end()) {
+	// Shares the defined value instead of copying it.
+	return it->second;
       }
+      // Moves reversed_iterator to a lower stack_frame.
+      ++rit;
     }
 
     // If value can't be found in whole stack_frame.
@@ -299,21 +280,11 @@ Cell* SymbolCell::eval() const
 // REGION class OperatorCell
 
 OperatorCell::OperatorCell(const char* const s)
-  : SymbolCell(s)
+  : SymbolCell(s, type_operator)
 {
   // Purposely Empty.
 }
 
-bool OperatorCell::is_operator() const
-{
-  return true;
-}
-
-bool OperatorCell::is_symbol() const
-{
-  return false;
-}
-
 Cell* OperatorCell::eval() const
 {
   return SymbolCell::clone();
@@ -321,7 +292,7 @@ Cell* OperatorCell::eval() const
 
 Cell* OperatorCell::eval(Cell* const args) const
 {
-  switch (get_operation((string) get_symbol())) {
+  switch (get_operation(get_symbol())) {
     case add_opr: {
       return arithmetic_eval(args, add_cells);
     }
@@ -394,6 +365,18 @@ Cell* OperatorCell::eval(Cell* const args) const
     case listp_opr: {
       return listp_eval(args);
     }
+    case eqp_opr: {
+      return eqp_eval(args);
+    }
+    case heapstats_opr: {
+      return heapstats_eval(args);
+    }
+    case orderedmap_opr: {
+      return orderedmap_eval(args);
+    }
+    case orderedmaprange_opr: {
+      return orderedmaprange_eval(args);
+    }
     default: {
       throw_error("Cannot evaluate unknown Operator Type",
 		  "OperatorCell::eval(Cell*)");
@@ -426,6 +409,7 @@ void OperatorCell::print(ostream& os) const
 ////////////////////////////////////////////////////////////////////////////////
 // REGION class ConsCell
 ConsCell::ConsCell(Cell* const my_car, Cell* const my_cdr)
+  : Cell(type_cons)
 {
   car_m = my_car;
   cdr_m = my_cdr;
@@ -433,42 +417,30 @@ ConsCell::ConsCell(Cell* const my_car, Cell* const my_cdr)
 
 ConsCell::~ConsCell()
 {
-  if (!nullp(get_car()))
-    delete car_m;
-  if (!nullp(get_cdr()))
-    delete cdr_m;
-}
-
-bool ConsCell::is_cons() const
-{
-  return true;
-}
-
-Cell* ConsCell::get_car() const
-{
-  return car_m;
-}
-
-Cell* ConsCell::get_cdr() const
-{
-  return cdr_m;
+  // Purposely Empty.
+  //   car and cdr may be shared, the heap reclaims them when unreachable.
 }
 
-void ConsCell::print(ostream& os) const
+/**
+ * \brief Prints a list in s-expression notation, whatever cells hold it.
+ * \param os The output stream to print to.
+ * \param head The first cons cell of the list.
+ */
+static void print_list(ostream& os, Cell* const head)
 {
   // Initial brackets
   os << "(";
-  if (!nullp(get_car())) {
-    get_car()->print(os);
+  if (!nullp(car(head))) {
+    car(head)->print(os);
   } else {
     os << "()";
   }
-  if (!nullp(get_cdr())) {
-    Cell* curr = get_cdr();
+  if (!nullp(cdr(head))) {
+    Cell* curr = cdr(head);
     // cdr requires looping inside.
     while (!nullp(curr)) {
       if (!listp(curr)) {
-	curr->print();
+	curr->print(os);
 	break;
       } else {
 	os << " ";
@@ -477,7 +449,7 @@ void ConsCell::print(ostream& os) const
 	  os << "()";
 	  break;
 	}
-	car(curr)->print();
+	car(curr)->print(os);
 	curr = cdr(curr);
       }
     }
@@ -485,64 +457,112 @@ void ConsCell::print(ostream& os) const
   os << ")";
 }
 
-Cell* ConsCell::clone() const
-{
-  return new ConsCell(get_car(), get_cdr());
-}
-
-Cell* ConsCell::eval() const
+/**
+ * \brief Evaluates a list as an application of its car to its cdr.
+ * \param head The first cons cell of the list.
+ * \param trace_prefix Where to report errors.
+ * \return The result from evaluation.
+ */
+static Cell* eval_list(Cell* const head, const string& trace_prefix)
 {
-  Cell* car = get_car();
-  Cell* cdr = get_cdr();
-
   // Initialize
   //  check if inner s-exprs
-  car = cell_eval(car);
+  Cell* operation = cell_eval(car(head));
 
   // Handle
   //  pass into deeper levels with car as operator, and cdr as arguments.
   //  else simply return car as result
-  if (operatorp(car) || procedurep(car)) {
-    return car->eval(cdr);
+  if (operatorp(operation) || procedurep(operation)) {
+    return operation->eval(cdr(head));
   } else {
-    throw_error("Cannot evaluate non-operator and non-function cells.", 
-		"ConsCell::eval()");
+    throw_error("Cannot evaluate non-operator and non-function cells.",
+		trace_prefix);
   }
 }
 
+void ConsCell::print(ostream& os) const
+{
+  print_list(os, const_cast<ConsCell*>(this));
+}
+
+Cell* ConsCell::clone() const
+{
+  return new ConsCell(get_car(), get_cdr());
+}
+
+Cell* ConsCell::eval() const
+{
+  return eval_list(const_cast<ConsCell*>(this), "ConsCell::eval()");
+}
+
 // ENDREGION class ConsCell
 ////////////////////////////////////////////////////////////////////////////////
 
+
 ////////////////////////////////////////////////////////////////////////////////
-// REGION class ProcedureCell
+// REGION class CompactConsCell
 
-ProcedureCell::ProcedureCell(Cell* const my_formals, Cell* const my_body)
+// The length must stay in the header's word, else a cell grows to 32 bytes.
+static_assert(sizeof(CompactConsCell) <= sizeof(Cell) + sizeof(Cell*),
+	      "CompactConsCell::length_m no longer fits in the Cell header");
+
+CompactConsCell::CompactConsCell(Cell* const my_car, const unsigned int length)
+  : Cell(type_cons, length > 1 ? cdr_next : cdr_nil)
 {
-  formals_m = my_formals;
-  body_m = my_body;
+  length_m = length;
+  car_m = my_car;
 }
 
-ProcedureCell::~ProcedureCell()
+Cell* CompactConsCell::make_block(const vector<Cell*>& elems)
+{
+  return make_block(&elems[0], elems.size());
+}
+
+Cell* CompactConsCell::make_block(Cell* const* elems, unsigned int length)
+{
+  CompactConsCell* block = static_cast<CompactConsCell*>(
+    heap_allocate_block(length * sizeof(CompactConsCell), length));
+
+  // Construct in place, the block is a single heap allocation.
+  for (unsigned int i = 0; i < length; ++i) {
+    ::new (block + i) CompactConsCell(elems[i], length - i);
+  }
+
+  return block;
+}
+
+void CompactConsCell::print(ostream& os) const
+{
+  print_list(os, const_cast<CompactConsCell*>(this));
+}
+
+Cell* CompactConsCell::clone() const
 {
-  if (!nullp(get_formals()))
-    delete formals_m;
-  if (!nullp(get_body()))
-    delete body_m;
+  return new ConsCell(get_car(), get_cdr());
 }
 
-bool ProcedureCell::is_procedure() const
+Cell* CompactConsCell::eval() const
 {
-  return true;
+  return eval_list(const_cast<CompactConsCell*>(this), "CompactConsCell::eval()");
 }
 
-Cell* ProcedureCell::get_formals() const
+// ENDREGION class CompactConsCell
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// REGION class ProcedureCell
+
+ProcedureCell::ProcedureCell(Cell* const my_formals, Cell* const my_body)
+  : Cell(type_procedure)
 {
-  return formals_m;
+  formals_m = my_formals;
+  body_m = my_body;
 }
 
-Cell* ProcedureCell::get_body() const
+ProcedureCell::~ProcedureCell()
 {
-  return body_m;
+  // Purposely Empty.
+  //   formals and body are shared with clones and with the parse tree.
 }
 
 void ProcedureCell::print(ostream& os) const
@@ -557,7 +577,8 @@ Cell* ProcedureCell::clone() const
 
 Cell* ProcedureCell::eval() const
 {
-  return clone();
+  // Cells are immutable, so the procedure itself can be shared.
+  return const_cast<ProcedureCell*>(this);
 }
 
 /**
@@ -566,8 +587,6 @@ Cell* ProcedureCell::eval() const
  */
 hashmap pair_formals_args(Cell* const formals, Cell* const args)
 {
-  string trace_prefix = "Cell.cpp::pair_formals_args(Cell*, Cell*)";
-
   hashmap defined_map;
   string key = "";
   pair<hashmap::iterator, bool> itbool_pair;
@@ -626,24 +645,24 @@ hashmap pair_formals_args(Cell* const formals, Cell* const args)
     }
     return defined_map;
   } catch (runtime_error& e) {
-    throw_error(e.what(), trace_prefix);
+    throw_error(e.what(), "Cell.cpp::pair_formals_args(Cell*, Cell*)");
   }
 }
 
 Cell* ProcedureCell::eval(Cell* const args) const
 {
-  string trace_prefix = "ProcedureCell::eval(Cell*)";
   Cell* formals = get_formals();
   Cell* body = get_body();
 
-  hashmap local_frame;
+  bool frame_pushed = false;
 
   Cell *expression, *next, *result;
   expression = next = result = nil;
   try {
     if (!nullp(formals)) {
-      local_frame = pair_formals_args(formals, args);
-      stack_frame.push_back(local_frame);
+      // The new frame is moved, not copied, into stack_frame.
+      stack_frame.push_back(pair_formals_args(formals, args));
+      frame_pushed = true;
     }
 
     next = body;
@@ -654,30 +673,66 @@ Cell* ProcedureCell::eval(Cell* const args) const
       next = cdr(next);
     }
 
-    if (!nullp(formals)) {
+    if (frame_pushed) {
       stack_frame.pop_back();
-      local_frame.clear();
     }
 
     return result;
   } catch (runtime_error& e) {
-    if (!local_frame.empty()) {
+    if (frame_pushed) {
       stack_frame.pop_back();
     }
-    throw_error(e.what(), trace_prefix);
+    throw_error(e.what(), "ProcedureCell::eval(Cell*)");
   }
 }
 
 Cell* ProcedureCell::apply(Cell* const args) const
 {
-  string trace_prefix = "ProcedureCell::apply(Cell*)";
-
   try {
     return eval(args);
   } catch (runtime_error& e) {
-    throw_error(e.what(), trace_prefix);
+    throw_error(e.what(), "ProcedureCell::apply(Cell*)");
   }
 }
 
 // ENDREGION class ProcedureCell
 ////////////////////////////////////////////////////////////////////////////////
+
+
+////////////////////////////////////////////////////////////////////////////////
+// REGION class MapCell
+
+MapCell::MapCell(ordered_map&& entries)
+  : Cell(type_map), map_m(std::move(entries))
+{
+  // The nodes are already allocated; a map over the limit is freed
+  //   when this throws.
+  heap_account_bytes(this, map_m.size() * ordered_map::node_bytes());
+}
+
+MapCell::~MapCell()
+{
+  // Purposely Empty.
+  //   map_m frees its own nodes; the key and value cells may be shared,
+  //   the heap reclaims them when unreachable.
+}
+
+void MapCell::print(ostream& os) const
+{
+  os << "#<ordered-map>";
+}
+
+Cell* MapCell::clone() const
+{
+  ordered_map copy(map_m);
+  return new MapCell(std::move(copy));
+}
+
+Cell* MapCell::eval() const
+{
+  // Cells are immutable, so the map itself can be shared.
+  return const_cast<MapCell*>(this);
+}
+
+// ENDREGION class MapCell
+////////////////////////////////////////////////////////////////////////////////
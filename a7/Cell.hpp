@@ -17,6 +17,9 @@
  *
  * Encapsulates the abstract interface for a concrete class-based
  * implementation of cells for a cons list data structure.
+ *
+ * Cells are immutable and shared; none of them owns another. They are all
+ * allocated on, and reclaimed by, the heap described in heap.hpp.
  */
 
 #ifndef CELL_HPP
@@ -34,9 +37,35 @@
 #include <stdexcept>
 #include <vector>
 #include "hashtablemap.hpp"
+#include "flathashmap.hpp"
+#include "heap.hpp"
 
 using namespace std;
 
+/**
+ * \enum TypeTag
+ * \brief enum TypeTag lists the one-byte type tags stored in every cell header
+ */
+enum TypeTag {
+  type_int = 0,
+  type_double,
+  type_symbol,
+  type_operator,
+  type_cons,
+  type_procedure,
+  type_map
+};
+
+/**
+ * \enum CdrCode
+ * \brief enum CdrCode tells where a cons cell keeps its cdr
+ */
+enum CdrCode {
+  cdr_normal = 0,  // explicit cdr pointer, see ConsCell
+  cdr_next,        // cdr is the next cell of the same block, see CompactConsCell
+  cdr_nil          // cdr is nil, last cell of a block
+};
+
 /**
  * \class Cell
  * \brief Class Cell
@@ -50,41 +79,116 @@ public:
    */
   virtual ~Cell();
 
+  /**
+   * \brief Allocates every cell on the garbage collected heap.
+   * \param size The size in bytes of the cell.
+   */
+  static void* operator new(size_t size);
+
+  /**
+   * \brief Releases the memory of a cell, only called by the heap.
+   * \param p The memory of the cell.
+   */
+  static void operator delete(void* p);
+
+  /**
+   * \brief Accessor for the type tag held in the cell header.
+   * \return The type tag of this cell.
+   */
+  TypeTag get_tag() const
+  {
+    return (TypeTag) tag_m;
+  }
+
+  /**
+   * \brief Accessor for the cdr code held in the cell header.
+   * \return cdr_normal unless this is a cell of a CDR-coded list block.
+   */
+  CdrCode get_cdr_code() const
+  {
+    return (CdrCode) cdr_code_m;
+  }
+
   /**
    * \brief Check if this is an int cell.
    * \return True iff this is an int cell.
    */
-  virtual bool is_int() const;
+  bool is_int() const
+  {
+    return tag_m == type_int;
+  }
 
   /**
    * \brief Check if this is a double cell.
    * \return True iff this is a double cell.
    */
-  virtual bool is_double() const;
+  bool is_double() const
+  {
+    return tag_m == type_double;
+  }
 
   /**
    * \brief Check if this is a symbol cell.
    * \return True iff this is a symbol cell.
    */
-  virtual bool is_symbol() const;
+  bool is_symbol() const
+  {
+    return tag_m == type_symbol;
+  }
 
   /**
    * \brief Check if this is a cons cell.
    * \return True iff this is a cons cell.
    */
-  virtual bool is_cons() const;
+  bool is_cons() const
+  {
+    return tag_m == type_cons;
+  }
 
   /**
    * \brief Check if this is an operation cell.
    * \return True iff this is an operation cell.
    */
-  virtual bool is_operator() const;
+  bool is_operator() const
+  {
+    return tag_m == type_operator;
+  }
 
   /**
    * \brief Check if this is an procedure cell.
    * \return True iff this is an procedure cell.
    */
-  virtual bool is_procedure() const;
+  bool is_procedure() const
+  {
+    return tag_m == type_procedure;
+  }
+
+  /**
+   * \brief Check if this is an ordered map cell.
+   * \return True iff this is an ordered map cell.
+   */
+  bool is_map() const
+  {
+    return tag_m == type_map;
+  }
+
+  /**
+   * \brief Accessor for the garbage collector mark bit.
+   * \return True iff the current collection has reached this cell.
+   */
+  bool is_marked() const
+  {
+    return mark_m;
+  }
+
+  /**
+   * \brief Sets the garbage collector mark bit.
+   * \param marked The new value of the mark bit.
+   */
+  void set_marked(const bool marked) const
+  {
+    mark_m = marked;
+  }
 
   /**
    * \brief Check if this cell holds a non-zero value.
@@ -148,12 +252,13 @@ public:
    */
   virtual void print(ostream& os = cout) const = 0;
   /**
-   * \brief Makes a new copy of the cell.
+   * \brief Makes a new copy of the cell, sharing any child cells.
    * \return A new copy of the cell.
    */
   virtual Cell* clone() const = 0;
   /**
-   * \brief Evaluates the Cell.
+   * \brief Evaluates the Cell. Values evaluate to themselves, without
+   * allocating a copy.
    * \return The result from evaluation.
    */
   virtual Cell* eval() const = 0;
@@ -169,6 +274,21 @@ public:
    * \return The result from applying the function.
    */
   virtual Cell* apply(Cell* const args) const;
+
+protected:
+  /**
+   * \brief Constructor for derived cells, stamps the header with a type tag.
+   * \param tag The type tag of the derived cell.
+   * \param cdr_code The cdr code of the derived cell.
+   */
+  Cell(const TypeTag tag, const CdrCode cdr_code = cdr_normal);
+
+private:
+  // Fixed header: one-byte type tag and cdr code, set once at construction,
+  //   and the mark bit used by the garbage collector.
+  const unsigned char tag_m;
+  const unsigned char cdr_code_m;
+  mutable bool mark_m;
 };
 
 /**
@@ -184,7 +304,6 @@ public:
    */
   IntCell(const int i);
 
-  virtual bool is_int() const;
   virtual bool is_nonzerovalue() const;
   virtual int get_int() const;
   virtual double get_value() const;
@@ -208,7 +327,6 @@ public:
    */
   DoubleCell(const double d);
 
-  virtual bool is_double() const;
   virtual bool is_nonzerovalue() const;
   virtual double get_double() const;
   virtual double get_value() const;
@@ -248,7 +366,11 @@ enum Operation {
   intp_opr,
   doublep_opr,
   symbolp_opr,
-  listp_opr
+  listp_opr,
+  eqp_opr,
+  heapstats_opr,
+  orderedmap_opr,
+  orderedmaprange_opr
 };
 
 /**
@@ -265,12 +387,18 @@ public:
    */
   SymbolCell(const char* const s);
   virtual ~SymbolCell();
-  virtual bool is_symbol() const;
   virtual bool is_nonzerovalue() const;
   virtual char* get_symbol() const;
   virtual void print(ostream& os = cout) const;
   virtual Cell* clone() const;
   virtual Cell* eval() const;
+protected:
+  /**
+   * \brief Constructor for cells deriving from SymbolCell.
+   * \param s holds a char pointer to a string.
+   * \param tag The type tag of the derived cell.
+   */
+  SymbolCell(const char* const s, const TypeTag tag);
 private:
   char* symbol_m;
 };
@@ -288,8 +416,6 @@ public:
    */
   OperatorCell(const char* const s);
 
-  virtual bool is_operator() const;
-  virtual bool is_symbol() const;
   virtual Cell* eval() const;
   virtual Cell* eval(Cell* const args) const;
   virtual Cell* apply(Cell* const args) const;
@@ -311,7 +437,6 @@ public:
   ConsCell(Cell* const my_car, Cell* const my_cdr);
   virtual ~ConsCell();
 
-  virtual bool is_cons() const;
   virtual Cell* get_car() const;
   virtual Cell* get_cdr() const;
   virtual void print(ostream& os = cout) const;
@@ -322,6 +447,58 @@ private:
   Cell* cdr_m;
 };
 
+/**
+ * \class CompactConsCell
+ * \brief Class CompactConsCell
+ *
+ * One cell of an immutable, nil-terminated list stored contiguously as a
+ * CDR-coded block: the cdr is not stored but implied by the cdr code, so
+ * each element only holds its car. Behaves as a cons cell through the
+ * usual car/cdr interface.
+ *
+ * A cell is 24 bytes against 32 for a ConsCell, a quarter less, and a
+ * whole list is one allocation. That is as small as a cell with a vtable
+ * can be: the length already shares the header's word, and the car takes
+ * the only other one.
+ */
+class CompactConsCell : public Cell
+{
+public:
+  /**
+   * \brief Makes a block holding a whole list.
+   * \param elems The cars of the list, in order (must not be empty).
+   * \return The first cell of the block.
+   */
+  static Cell* make_block(const vector<Cell*>& elems);
+
+  /**
+   * \brief Makes a block holding a whole list.
+   * \param elems The cars of the list, in order.
+   * \param length The number of cars (must not be 0).
+   * \return The first cell of the block.
+   */
+  static Cell* make_block(Cell* const* elems, unsigned int length);
+
+  virtual Cell* get_car() const;
+  virtual Cell* get_cdr() const;
+
+  /**
+   * \brief Accessor for the number of cells from this one to the end of
+   * the list, i.e. the size of the list starting here.
+   */
+  unsigned int get_length() const;
+
+  virtual void print(ostream& os = cout) const;
+  virtual Cell* clone() const;
+  virtual Cell* eval() const;
+private:
+  CompactConsCell(Cell* const my_car, const unsigned int length);
+
+  // Packed into the spare bytes of the Cell header's word.
+  unsigned int length_m;
+  Cell* car_m;
+};
+
 /**
  * \class ProcedureCell
  * \brief Class ProcedureCell
@@ -337,7 +514,6 @@ public:
   ProcedureCell(Cell* const my_formals, Cell* const my_body);
   virtual ~ProcedureCell();
 
-  virtual bool is_procedure() const;
   virtual Cell* get_formals() const;
   virtual Cell* get_body() const;
   virtual void print(ostream& os = cout) const;
@@ -350,8 +526,120 @@ private:
   Cell* body_m;
 };
 
+/**
+ * \class MapCell
+ * \brief Class MapCell
+ *
+ * An immutable map from numbers to cells, ordered by key, so that a range
+ * scan costs the size of its result. Each entry keeps its key cell too,
+ * so int and double keys come back as given.
+ */
+class MapCell : public Cell
+{
+public:
+  typedef bstmap<double, pair<Cell*, Cell*> > ordered_map;
+
+  /**
+   * \brief Constructor to make MapCell
+   * \param entries The entries, mapping each key's value to the key cell
+   * and the value cell; taken over, leaving entries empty.
+   */
+  MapCell(ordered_map&& entries);
+  virtual ~MapCell();
+
+  /**
+   * \brief Accessor for the entries, for range scans and for the
+   * garbage collector.
+   */
+  const ordered_map& get_map() const;
+
+  virtual void print(ostream& os = cout) const;
+  virtual Cell* clone() const;
+  virtual Cell* eval() const;
+private:
+  ordered_map map_m;
+};
+
 extern Cell* const nil;
+
+// Accessors below are defined inline so that cons.hpp can call them
+// directly, without virtual dispatch, once the type tag has been checked.
+
+inline int IntCell::get_int() const
+{
+  return int_m;
+}
+
+inline double IntCell::get_value() const
+{
+  return (double) int_m;
+}
+
+inline double DoubleCell::get_double() const
+{
+  return double_m;
+}
+
+inline double DoubleCell::get_value() const
+{
+  return double_m;
+}
+
+inline char* SymbolCell::get_symbol() const
+{
+  return symbol_m;
+}
+
+inline Cell* ConsCell::get_car() const
+{
+  return car_m;
+}
+
+inline Cell* ConsCell::get_cdr() const
+{
+  return cdr_m;
+}
+
+inline Cell* CompactConsCell::get_car() const
+{
+  return car_m;
+}
+
+inline Cell* CompactConsCell::get_cdr() const
+{
+  if (get_cdr_code() == cdr_next) {
+    return const_cast<CompactConsCell*>(this + 1);
+  } else {
+    return nil;
+  }
+}
+
+inline unsigned int CompactConsCell::get_length() const
+{
+  return length_m;
+}
+
+inline Cell* ProcedureCell::get_formals() const
+{
+  return formals_m;
+}
+
+inline Cell* ProcedureCell::get_body() const
+{
+  return body_m;
+}
+
+inline const MapCell::ordered_map& MapCell::get_map() const
+{
+  return map_m;
+}
+
+// Frames use the chained hashtablemap unless built with -DFLAT_HASHMAP.
+#ifdef FLAT_HASHMAP
+typedef flathashmap<string, Cell*> hashmap;
+#else
 typedef hashtablemap<string, Cell*> hashmap;
+#endif
 extern vector< hashmap > stack_frame;
 
 #endif
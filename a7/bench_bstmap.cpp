@@ -0,0 +1,109 @@
+/**
+ * \file bench_bstmap.cpp
+ *
+ * Benchmark of bstmap against std::map with keys inserted in sorted
+ * order, the worst case of an unbalanced tree: inserts, lookups of
+ * every key, then erasing every key. The hint rows insert each key with
+ * the previous one as the hint, and the bulk rows build each map at
+ * once from the sorted keys, with its range constructor.
+ *
+ * Usage: bench_bstmap [number of keys, default 1000000]
+ */
+
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "bstmap.hpp"
+
+using namespace std;
+
+/**
+ * \brief Gets the processor time used so far.
+ * \return The time in milliseconds.
+ */
+double now_ms()
+{
+  return 1000.0 * clock() / CLOCKS_PER_SEC;
+}
+
+/**
+ * \brief How a benchmark loads the keys into a map.
+ */
+enum load_mode {
+  LOAD_INSERT,
+  LOAD_HINT,
+  LOAD_BULK
+};
+
+/**
+ * \brief Times each operation on one map type and prints a table row.
+ * \param name The name of the map type.
+ * \param n The number of keys, inserted as 0, 1, ..., n - 1.
+ * \param mode How to load the keys.
+ */
+template <class Map>
+void bench(const string& name, int n, load_mode mode)
+{
+  vector< pair<int, int> > sorted;
+  for (int i = 0; i < n; ++i) {
+    sorted.push_back(pair<int, int>(i, i));
+  }
+
+  Map map;
+  long long checksum = 0;
+
+  double start = now_ms();
+  if (mode == LOAD_BULK) {
+    Map built(sorted.begin(), sorted.end());
+    map.swap(built);
+  } else if (mode == LOAD_HINT) {
+    typename Map::iterator hint = map.end();
+    for (int i = 0; i < n; ++i) {
+      hint = map.insert(hint, typename Map::value_type(i, i));
+    }
+  } else {
+    for (int i = 0; i < n; ++i) {
+      map.insert(typename Map::value_type(i, i));
+    }
+  }
+  double insert_ms = now_ms() - start;
+
+  start = now_ms();
+  for (int i = 0; i < n; ++i) {
+    checksum += map.find(i)->second;
+  }
+  double find_ms = now_ms() - start;
+
+  start = now_ms();
+  for (int i = 0; i < n; ++i) {
+    checksum += map.erase(i);
+  }
+  double erase_ms = now_ms() - start;
+
+  cout << left << setw(14) << name << right << setw(9) << n
+       << fixed << setprecision(1)
+       << setw(11) << insert_ms << setw(11) << find_ms << setw(11) << erase_ms
+       << "   (" << checksum << ")" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+
+  cout << left << setw(14) << "map" << right << setw(9) << "keys"
+       << setw(11) << "insert ms" << setw(11) << "find ms" << setw(11) << "erase ms"
+       << endl;
+
+  bench< bstmap<int, int> >("bstmap", n, LOAD_INSERT);
+  bench< map<int, int> >("std::map", n, LOAD_INSERT);
+  bench< bstmap<int, int> >("bstmap hint", n, LOAD_HINT);
+  bench< map<int, int> >("std::map hint", n, LOAD_HINT);
+  bench< bstmap<int, int> >("bstmap bulk", n, LOAD_BULK);
+  bench< map<int, int> >("std::map bulk", n, LOAD_BULK);
+
+  return 0;
+}
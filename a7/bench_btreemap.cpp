@@ -0,0 +1,113 @@
+/**
+ * \file bench_btreemap.cpp
+ *
+ * Benchmark of btreemap against bstmap and std::map on keys in random
+ * order, so that every lookup misses the cache: inserts, lookups of
+ * every key, an in-order scan of the whole map, then erasing every key.
+ * Keys are looked up and erased in another order than they were
+ * inserted, so nodes allocated one after the other are not visited
+ * one after the other.
+ *
+ * Usage: bench_btreemap [number of keys, default 1000000]
+ */
+
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "bstmap.hpp"
+#include "btreemap.hpp"
+
+using namespace std;
+
+/**
+ * \brief Gets the processor time used so far.
+ * \return The time in milliseconds.
+ */
+double now_ms()
+{
+  return 1000.0 * clock() / CLOCKS_PER_SEC;
+}
+
+/**
+ * \brief Times each operation on one map type and prints a table row.
+ * \param name The name of the map type.
+ * \param keys The keys, in the order to insert them.
+ * \param lookups The same keys, in the order to look up and erase them.
+ */
+template <class Map>
+void bench(const string& name, const vector<int>& keys, const vector<int>& lookups)
+{
+  Map map;
+  long long checksum = 0;
+  int n = keys.size();
+
+  double start = now_ms();
+  for (int i = 0; i < n; ++i) {
+    map.insert(typename Map::value_type(keys[i], i));
+  }
+  double insert_ms = now_ms() - start;
+
+  start = now_ms();
+  for (int i = 0; i < n; ++i) {
+    checksum += map.find(lookups[i])->second;
+  }
+  double find_ms = now_ms() - start;
+
+  start = now_ms();
+  for (typename Map::iterator it = map.begin(); it != map.end(); ++it) {
+    checksum += it->first;
+  }
+  double scan_ms = now_ms() - start;
+
+  start = now_ms();
+  for (int i = 0; i < n; ++i) {
+    checksum += map.erase(lookups[i]);
+  }
+  double erase_ms = now_ms() - start;
+
+  cout << left << setw(10) << name << right << setw(9) << n
+       << fixed << setprecision(1)
+       << setw(11) << insert_ms << setw(11) << find_ms << setw(11) << scan_ms
+       << setw(11) << erase_ms << "   (" << checksum << ")" << endl;
+}
+
+/**
+ * \brief Makes a random permutation of 0, 1, ..., n - 1.
+ */
+vector<int> shuffled(int n)
+{
+  vector<int> keys(n);
+  for (int i = 0; i < n; ++i) {
+    keys[i] = i;
+  }
+  for (int i = n - 1; i > 0; --i) {
+    int j = (int) ((double) rand() / ((double) RAND_MAX + 1) * (i + 1));
+    int temp = keys[i];
+    keys[i] = keys[j];
+    keys[j] = temp;
+  }
+  return keys;
+}
+
+int main(int argc, char* argv[])
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+
+  srand(42);
+  vector<int> keys = shuffled(n);
+  vector<int> lookups = shuffled(n);
+
+  cout << left << setw(10) << "map" << right << setw(9) << "keys"
+       << setw(11) << "insert ms" << setw(11) << "find ms" << setw(11) << "scan ms"
+       << setw(11) << "erase ms" << endl;
+
+  bench< btreemap<int, int> >("btreemap", keys, lookups);
+  bench< bstmap<int, int> >("bstmap", keys, lookups);
+  bench< map<int, int> >("std::map", keys, lookups);
+
+  return 0;
+}
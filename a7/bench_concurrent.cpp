@@ -0,0 +1,150 @@
+/**
+ * \file bench_concurrent.cpp
+ *
+ * Benchmark of the sharded concurrenthashmap against one hashtablemap
+ * behind a single reader-writer lock, from 1 to 32 threads, with a
+ * read-heavy mix: 90% lookups, 5% inserts and 5% erases over string keys.
+ *
+ * Usage: bench_concurrent [operations per thread, default 200000]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "hashtablemap.hpp"
+#include "concurrenthashmap.hpp"
+
+using namespace std;
+
+typedef chrono::steady_clock bench_clock;
+
+size_t const KEY_COUNT = 100000;
+
+/**
+ * \class lockedmap
+ * \brief One hashtablemap and one lock around it: the baseline.
+ */
+class lockedmap
+{
+  mutable shared_mutex lock_m;
+  hashtablemap<string, int> map_m;
+
+public:
+  bool find(const string& k, int& value) const
+  {
+    shared_lock<shared_mutex> guard(lock_m);
+    hashtablemap<string, int>::const_iterator it = map_m.find(k);
+    if (it == map_m.end()) {
+      return false;
+    }
+    value = it->second;
+    return true;
+  }
+
+  bool insert_or_assign(const string& k, int value)
+  {
+    unique_lock<shared_mutex> guard(lock_m);
+    return map_m.insert_or_assign(k, value).second;
+  }
+
+  unsigned int erase(const string& k)
+  {
+    unique_lock<shared_mutex> guard(lock_m);
+    return map_m.erase(k);
+  }
+};
+
+/**
+ * \brief Runs one thread's share of the mix.
+ * \param map The map all threads share.
+ * \param keys The keys to use.
+ * \param seed Makes each thread visit the keys in its own order.
+ * \param ops The number of operations.
+ * \param checksum Receives a value depending on every lookup.
+ */
+template <class Map>
+void worker(Map& map, const vector<string>& keys, unsigned int seed,
+	    size_t ops, size_t& checksum)
+{
+  unsigned long long state = seed * 0x9e3779b97f4a7c15ULL + 1;
+  size_t sum = 0;
+  int value;
+
+  for (size_t i = 0; i < ops; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    const string& key = keys[(state >> 33) % keys.size()];
+    unsigned int dice = (state >> 20) % 100;
+
+    if (dice < 90) {
+      if (map.find(key, value)) {
+	sum += value;
+      }
+    } else if (dice < 95) {
+      map.insert_or_assign(key, (int) i);
+    } else {
+      sum += map.erase(key);
+    }
+  }
+  checksum = sum;
+}
+
+/**
+ * \brief Times the mix on one map type with a given number of threads.
+ * \return The throughput in millions of operations per second.
+ */
+template <class Map>
+double bench(const vector<string>& keys, unsigned int threads, size_t ops)
+{
+  Map map;
+  for (size_t i = 0; i < keys.size(); i += 2) {
+    map.insert_or_assign(keys[i], (int) i);
+  }
+
+  vector<thread> pool;
+  vector<size_t> checksums(threads);
+
+  bench_clock::time_point start = bench_clock::now();
+  for (unsigned int t = 0; t < threads; ++t) {
+    pool.push_back(thread(worker<Map>, ref(map), cref(keys), t, ops,
+			  ref(checksums[t])));
+  }
+  for (unsigned int t = 0; t < threads; ++t) {
+    pool[t].join();
+  }
+  double seconds = chrono::duration<double>(bench_clock::now() - start).count();
+
+  return threads * ops / seconds / 1e6;
+}
+
+int main(int argc, char* argv[])
+{
+  size_t ops = argc > 1 ? atol(argv[1]) : 200000;
+
+  vector<string> keys;
+  keys.reserve(KEY_COUNT);
+  for (size_t i = 0; i < KEY_COUNT; ++i) {
+    stringstream ss;
+    ss << "var-" << i;
+    keys.push_back(ss.str());
+  }
+
+  cout << "hardware threads: " << thread::hardware_concurrency() << endl;
+  cout << right << setw(8) << "threads" << setw(16) << "locked Mops/s"
+       << setw(16) << "sharded Mops/s" << endl;
+
+  for (unsigned int threads = 1; threads <= 32; threads *= 2) {
+    double locked = bench<lockedmap>(keys, threads, ops);
+    double sharded = bench< concurrenthashmap<string, int> >(keys, threads, ops);
+    cout << setw(8) << threads << fixed << setprecision(2)
+	 << setw(16) << locked << setw(16) << sharded << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,117 @@
+/**
+ * \file bench_hashmap.cpp
+ *
+ * Benchmark of the chained hashtablemap against the open-addressing
+ * flathashmap, with the string keys the stack frames use: inserts,
+ * successful and failed lookups, a full iteration, then erasing all keys.
+ *
+ * Usage: bench_hashmap [largest number of keys, default 1000000]
+ */
+
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "hashtablemap.hpp"
+#include "flathashmap.hpp"
+
+using namespace std;
+
+/**
+ * \brief Gets the processor time used so far.
+ * \return The time in milliseconds.
+ */
+double now_ms()
+{
+  return 1000.0 * clock() / CLOCKS_PER_SEC;
+}
+
+/**
+ * \brief Builds n distinct keys shaped like Scheme identifiers.
+ * \param prefix Distinguishes key sets, so two sets never intersect.
+ * \param n The number of keys.
+ * \return The keys.
+ */
+vector<string> make_keys(const string& prefix, size_t n)
+{
+  vector<string> keys;
+  keys.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    stringstream ss;
+    ss << prefix << "-var-" << i;
+    keys.push_back(ss.str());
+  }
+  return keys;
+}
+
+/**
+ * \brief Times each operation on one map type and prints a table row.
+ * \param name The name of the map type.
+ * \param keys The keys to insert, then look up.
+ * \param missing Keys never inserted.
+ */
+template <class Map>
+void bench(const string& name, const vector<string>& keys,
+	   const vector<string>& missing)
+{
+  Map map;
+  size_t checksum = 0;
+
+  double start = now_ms();
+  for (size_t i = 0; i < keys.size(); ++i) {
+    map.insert(typename Map::value_type(keys[i], (int) i));
+  }
+  double insert_ms = now_ms() - start;
+
+  start = now_ms();
+  for (size_t i = 0; i < keys.size(); ++i) {
+    checksum += map.find(keys[i])->second;
+  }
+  double hit_ms = now_ms() - start;
+
+  start = now_ms();
+  for (size_t i = 0; i < missing.size(); ++i) {
+    checksum += map.count(missing[i]);
+  }
+  double miss_ms = now_ms() - start;
+
+  start = now_ms();
+  for (typename Map::iterator it = map.begin(); it != map.end(); ++it) {
+    checksum += it->second;
+  }
+  double iterate_ms = now_ms() - start;
+
+  start = now_ms();
+  for (size_t i = 0; i < keys.size(); ++i) {
+    checksum += map.erase(keys[i]);
+  }
+  double erase_ms = now_ms() - start;
+
+  cout << left << setw(14) << name << right << setw(9) << keys.size()
+       << fixed << setprecision(1)
+       << setw(11) << insert_ms << setw(11) << hit_ms << setw(11) << miss_ms
+       << setw(11) << iterate_ms << setw(11) << erase_ms
+       << "   (" << checksum << ")" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+  size_t largest = argc > 1 ? atol(argv[1]) : 1000000;
+
+  cout << left << setw(14) << "map" << right << setw(9) << "keys"
+       << setw(11) << "insert ms" << setw(11) << "hit ms" << setw(11) << "miss ms"
+       << setw(11) << "iterate ms" << setw(11) << "erase ms" << endl;
+
+  for (size_t n = 1000; n <= largest; n *= 10) {
+    vector<string> keys = make_keys("in", n);
+    vector<string> missing = make_keys("out", n);
+
+    bench< hashtablemap<string, int> >("hashtablemap", keys, missing);
+    bench< flathashmap<string, int> >("flathashmap", keys, missing);
+  }
+
+  return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ * \file bench_parse.cpp
+ *
+ * Benchmark of the parser's throughput on generated programs of a few
+ * megabytes. The forms rows read the text one top-level s-expression
+ * at a time with parse_next, as a file is read; the list rows parse the
+ * whole text wrapped in one list with parse, the worst case for a
+ * parser that copies its input.
+ *
+ * Usage: bench_parse [largest size in megabytes, default 8]
+ */
+
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "parse.hpp"
+#include "heap.hpp"
+
+using namespace std;
+
+/**
+ * \brief Gets the processor time used so far.
+ * \return The time in milliseconds.
+ */
+double now_ms()
+{
+  return 1000.0 * clock() / CLOCKS_PER_SEC;
+}
+
+/**
+ * \brief Generates a program of top-level forms.
+ * \param bytes The size to reach.
+ * \return The text of the program.
+ */
+string make_program(size_t bytes)
+{
+  string text;
+  text.reserve(bytes + 256);
+  for (int i = 0; text.size() < bytes; ++i) {
+    text += "(define (f" + to_string(i) + " x y)\n";
+    text += "  (if (< x " + to_string(i % 97) + ")\n";
+    text += "      (+ x -" + to_string(i % 13) + " 2.5 (quote (a b \"c d\")))\n";
+    text += "      (let ((z (* y 0.125))) (cons z (quote ())))))\n";
+  }
+  return text;
+}
+
+/**
+ * \brief Counts the cells of a parse tree.
+ * \param c The root of the tree.
+ * \return The number of non-nil cells in it.
+ */
+long long count_cells(Cell* c)
+{
+  if (!listp(c)) {
+    return nullp(c) ? 0 : 1;
+  }
+  long long cells = 0;
+  for (; !nullp(c); c = cdr(c)) {
+    cells += 1 + count_cells(car(c));
+  }
+  return cells;
+}
+
+/**
+ * \brief Times parsing of one program and prints a table row.
+ * \param name The name of the row.
+ * \param text The program.
+ * \param as_list Whether to parse the program wrapped in one list,
+ * rather than form by form.
+ */
+void bench(const string& name, const string& text, bool as_list)
+{
+  vector<Cell*> trees;
+
+  double start = now_ms();
+  if (as_list) {
+    trees.push_back(parse("(" + text + ")"));
+  } else {
+    size_t pos = 0;
+    Cell* form;
+    while ((form = parse_next(text, pos)) != nil) {
+      trees.push_back(form);
+    }
+  }
+  double ms = now_ms() - start;
+
+  long long cells = 0;
+  for (size_t i = 0; i < trees.size(); ++i) {
+    cells += count_cells(trees[i]);
+  }
+  int forms = trees.size();
+
+  double mb = text.size() / (1024.0 * 1024.0);
+  cout << left << setw(8) << name << right << fixed << setprecision(2)
+       << setw(9) << mb << setw(9) << forms << setw(11) << cells
+       << setprecision(1) << setw(11) << ms << setw(11) << (ms > 0 ? 1000.0 * mb / ms : 0.0)
+       << endl;
+
+  // the trees are unreachable; free them before the next row
+  heap_collect();
+}
+
+int main(int argc, char* argv[])
+{
+  size_t largest = argc > 1 ? atoi(argv[1]) : 8;
+
+  cout << left << setw(8) << "parse" << right << setw(9) << "MB" << setw(9) << "forms"
+       << setw(11) << "cells" << setw(11) << "ms" << setw(11) << "MB/s" << endl;
+
+  for (size_t mb = 1; mb <= largest; mb *= 2) {
+    string text = make_program(mb * 1024 * 1024);
+    bench("forms", text, false);
+    bench("list", text, true);
+  }
+
+  return 0;
+}
@@ -0,0 +1,78 @@
+/**
+ * \file bench_rehash.cpp
+ *
+ * Benchmark of insert latency in hashtablemap with and without
+ * incremental rehashing: times every single insert of a million string
+ * keys and reports the total, the 99.9th percentile and the worst case.
+ *
+ * Usage: bench_rehash [number of keys, default 1000000]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "hashtablemap.hpp"
+
+using namespace std;
+
+typedef chrono::steady_clock bench_clock;
+
+/**
+ * \brief Inserts every key one by one, timing each insert.
+ * \param name The name of the mode.
+ * \param keys The keys to insert.
+ * \param incremental True to turn incremental rehashing on.
+ */
+void bench(const string& name, const vector<string>& keys, bool incremental)
+{
+  hashtablemap<string, int> map;
+  map.incremental_rehash(incremental);
+
+  vector<double> latencies_us;
+  latencies_us.reserve(keys.size());
+
+  bench_clock::time_point begin = bench_clock::now();
+  for (size_t i = 0; i < keys.size(); ++i) {
+    bench_clock::time_point start = bench_clock::now();
+    map.insert(pair<const string, int>(keys[i], (int) i));
+    bench_clock::time_point stop = bench_clock::now();
+    latencies_us.push_back(chrono::duration<double, micro>(stop - start).count());
+  }
+  double total_ms = chrono::duration<double, milli>(bench_clock::now() - begin).count();
+
+  sort(latencies_us.begin(), latencies_us.end());
+  double p999_us = latencies_us[latencies_us.size() * 999 / 1000];
+  double max_us = latencies_us.back();
+
+  cout << left << setw(14) << name << right << setw(9) << keys.size()
+       << fixed << setprecision(1) << setw(11) << total_ms
+       << setw(12) << p999_us << setw(12) << max_us
+       << setw(10) << map.bucket_count() << endl;
+}
+
+int main(int argc, char* argv[])
+{
+  size_t n = argc > 1 ? atol(argv[1]) : 1000000;
+
+  vector<string> keys;
+  keys.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    stringstream ss;
+    ss << "var-" << i;
+    keys.push_back(ss.str());
+  }
+
+  cout << left << setw(14) << "rehash" << right << setw(9) << "keys"
+       << setw(11) << "total ms" << setw(12) << "p99.9 us" << setw(12) << "max us"
+       << setw(10) << "buckets" << endl;
+
+  bench("all at once", keys, false);
+  bench("incremental", keys, true);
+
+  return 0;
+}
@@ -10,7 +10,14 @@
 /**
  * \file bstmap.hpp
  *
- * Creates a Binary Search Tree Map.
+ * Creates a Binary Search Tree Map, kept balanced as a red-black tree:
+ * find, insert and erase are O(log n) even for keys inserted in order.
+ * Every node also counts the nodes of its subtree, for an O(1) size()
+ * and O(log n) order statistics: rank(), select() and count_range().
+ * lower_bound(), upper_bound() and range() start an in-order scan at any
+ * key in O(log n), so a range scan costs the size of its result.
+ * Sorted input is loaded in linear time by bulk_insert(), and merge()
+ * joins two maps in linear time, both building a perfectly balanced tree.
  */
 
 
@@ -19,17 +26,25 @@
 #include <iterator>
 #include <iostream>
 #include <stdexcept>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "poolallocator.hpp"
 
 using namespace std;
 
 /**
  * \class bstmap
  * \brief Class bstmap
+ *
+ * Nodes are allocated with Alloc rebound to the node type; the default
+ * pool_allocator recycles them instead of calling malloc every time.
  */
-template <class Key, class T>
+template <class Key, class T, class Alloc = pool_allocator<pair<const Key, T> > >
 class bstmap
 {
-  typedef bstmap<Key, T>     Self;
+  typedef bstmap<Key, T, Alloc> Self;
 
 public:
   typedef Key                key_type;
@@ -37,6 +52,7 @@ public:
   typedef pair<const Key, T> value_type;
   typedef unsigned int       size_type;
   typedef int                difference_type;
+  typedef Alloc              allocator_type;
 
 private:
   /**
@@ -46,12 +62,17 @@ private:
   class Node  {
   public:
     Node (value_type val, Node* parent = NULL,  Node* left = NULL, Node* right = NULL) :
-      value_m(val), parent_m(parent), left_m(left), right_m(right) {}
+      value_m(val), parent_m(parent), left_m(left), right_m(right), red_m(true),
+      count_m(1) {}
 
     value_type value_m;
     Node* parent_m;
     Node* left_m;
     Node* right_m;
+    // red-black color: new nodes are red, the root and NULL leaves black.
+    bool red_m;
+    // number of nodes in the subtree rooted here, this one included.
+    size_type count_m;
 
     ~Node() {
       // Don't delete because this Node does not "own" the others
@@ -61,8 +82,13 @@ private:
     }
   };
 
+  typedef typename allocator_traits<Alloc>::template rebind_alloc<Node> node_allocator;
+
   Node* root_m;
 
+  // allocates the nodes.
+  node_allocator alloc_m;
+
 public:
   template<typename _T>
   class _iterator 
@@ -162,6 +188,15 @@ public:
   // default constructor to create an empty map
   bstmap() : root_m(NULL) {}
 
+  // builds a perfectly balanced map from values sorted by key, in O(n).
+  //   See bulk_insert().
+  template <class InputIterator>
+  bstmap(InputIterator sorted_first, InputIterator sorted_last)
+    : root_m(NULL)
+  {
+    bulk_insert(sorted_first, sorted_last);
+  }
+
   ~bstmap() 
   {
     clear();
@@ -169,12 +204,19 @@ public:
   }
 
   // overload copy constructor to do a deep copy
+  //   Clones the tree node by node, so the copy keeps x's shape
+  //   (reinserting in order would degenerate it into a list).
   bstmap(const Self& x) 
-    : root_m(NULL)
+    : root_m(NULL), alloc_m(x.alloc_m)
   {
-    for (const_iterator i = x.begin(); i != x.end(); ++i) {
-      insert(*i); // Insert value at x's i
-    }
+    root_m = _clone(x.root_m, NULL);
+  }
+
+  // move constructor: takes x's nodes, leaving x empty
+  bstmap(Self&& x) noexcept
+    : root_m(x.root_m), alloc_m(x.alloc_m)
+  {
+    x.root_m = NULL;
   }
 
   // overload assignment to do a deep copy
@@ -186,10 +228,38 @@ public:
     }
 
     clear();
+    root_m = _clone(x.root_m, NULL);
+    return (*this);
+  }
+
+  // move assignment: takes x's nodes, leaving x empty
+  Self& operator=(Self&& x) noexcept
+  {
+    if (this != &x) {
+      clear();
+      alloc_m = x.alloc_m;
+      root_m = x.root_m;
+      x.root_m = NULL;
+    }
+    return (*this);
+  }
 
-    for (const_iterator i = x.begin(); i != x.end(); ++i) {
-      insert(*i); // Insert value at x's i
-    }    
+  // exchanges the contents of two maps in O(1)
+  void swap(Self& x) noexcept
+  {
+    Node* temp = root_m;
+    root_m = x.root_m;
+    x.root_m = temp;
+
+    node_allocator temp_alloc = alloc_m;
+    alloc_m = x.alloc_m;
+    x.alloc_m = temp_alloc;
+  }
+
+  // returns a copy of the allocator.
+  allocator_type get_allocator() const
+  {
+    return allocator_type(alloc_m);
   }
 
   // accessors:
@@ -232,35 +302,142 @@ public:
 
   size_type size() const 
   {
-    return _size(root_m);
+    return _count(root_m);
+  }
+
+  // bytes taken by each element, node included
+  static size_t node_bytes()
+  {
+    return sizeof(Node);
   }
 
   pair<iterator, bool> insert(const value_type& x) 
   {
-    Node* ret_n;
-    bool ret_b;
     pair<Node*, bool> my_pair = _find(x.first, root_m);
 
     if (my_pair.second == true) {
       // means value is already in tree
-      ret_b = false;
-      ret_n = my_pair.first;
-    } else if (my_pair.first == NULL) {
-      // First Node insertaion
-      ret_n = root_m = new Node(x);
-      ret_b = true;
-    } else {
-      // create and insert new node
-      Node* new_node = new Node(x, my_pair.first);
-      if (x.first < (my_pair.first->value_m).first) {
-	ret_n = my_pair.first->left_m = new_node;      
-      } else {
-	ret_n = my_pair.first->right_m = new_node;
+      return pair<iterator, bool>(iterator(this, my_pair.first), false);
+    }
+
+    // create and insert new node
+    Node* new_node = _new_node(x, my_pair.first);
+    _link_new(new_node);
+    return pair<iterator, bool>(iterator(this, new_node), true);
+  }
+
+  // inserts x, searching for its place from hint rather than from the
+  //   root: when x belongs right before or right after hint's element
+  //   (at the end for end()), it takes one or two comparisons instead
+  //   of O(log n), and the red-black fix-up is amortized O(1). Loading
+  //   sorted values with hint = insert(hint, x), or with end() as the
+  //   hint, never searches. A wrong hint costs one search from the root.
+  //   returns an iterator to the element with x's key.
+  iterator insert(iterator hint, const value_type& x)
+  {
+    pair<Node*, bool> my_pair = _find_hint(x.first, hint.node_m);
+
+    if (my_pair.second == true) {
+      return iterator(this, my_pair.first);
+    }
+
+    Node* new_node = _new_node(x, my_pair.first);
+    _link_new(new_node);
+    return iterator(this, new_node);
+  }
+
+  // inserts an element constructed in place from args, placed from hint
+  //   as by insert(hint, x); it is destroyed again if its key is already
+  //   in the map. returns an iterator to the element with that key.
+  template <class... Args>
+  iterator emplace_hint(iterator hint, Args&&... args)
+  {
+    // The key is only known once the element is built.
+    Node* new_node = _new_node(value_type(std::forward<Args>(args)...));
+    pair<Node*, bool> my_pair = _find_hint(new_node->value_m.first, hint.node_m);
+
+    if (my_pair.second == true) {
+      _delete_node(new_node);
+      return iterator(this, my_pair.first);
+    }
+
+    new_node->parent_m = my_pair.first;
+    _link_new(new_node);
+    return iterator(this, new_node);
+  }
+
+  // inserts values sorted by key in O(size() + their number):
+  //   merges them with the map's nodes in order, then relinks all the
+  //   nodes into a perfectly balanced tree. As with insert(), a key
+  //   already in the map keeps its value, and so does the first of
+  //   repeated keys. Values found out of order are still inserted,
+  //   one insert() each.
+  template <class InputIterator>
+  void bulk_insert(InputIterator sorted_first, InputIterator sorted_last)
+  {
+    vector<Node*> added;
+
+    try {
+      for (; sorted_first != sorted_last; ++sorted_first) {
+	const value_type& x = *sorted_first;
+
+	if (!added.empty() && !(added.back()->value_m.first < x.first)) {
+	  if (x.first < added.back()->value_m.first) {
+	    // out of order: insert the rest one by one.
+	    break;
+	  }
+	  // repeated key
+	  continue;
+	}
+	added.push_back(_new_node(x));
       }
-      ret_b = true;
+    } catch (...) {
+      for (size_t i = 0; i < added.size(); ++i) {
+	_delete_node(added[i]);
+      }
+      throw;
     }
-    
-    return pair<iterator, bool>(iterator(this, ret_n), ret_b);
+
+    if (!added.empty()) {
+      vector<Node*> nodes;
+      vector<Node*> merged;
+      vector<Node*> repeated;
+
+      _flatten(root_m, nodes);
+      _merge_nodes(nodes, added, merged, repeated);
+      root_m = _build(merged);
+
+      for (size_t i = 0; i < repeated.size(); ++i) {
+	_delete_node(repeated[i]);
+      }
+    }
+
+    for (; sorted_first != sorted_last; ++sorted_first) {
+      insert(*sorted_first);
+    }
+  }
+
+  // moves into this map every element of x whose key it lacks, in
+  //   O(size() + x.size()) and without copying: x keeps only the keys
+  //   found in both. Both trees are rebuilt perfectly balanced.
+  //   x's nodes are freed by this map's allocator, so the two must
+  //   compare equal, as pool_allocators always do.
+  void merge(Self& x)
+  {
+    if (this == &x || x.root_m == NULL) {
+      return;
+    }
+
+    vector<Node*> nodes;
+    vector<Node*> x_nodes;
+    vector<Node*> merged;
+    vector<Node*> repeated;
+
+    _flatten(root_m, nodes);
+    _flatten(x.root_m, x_nodes);
+    _merge_nodes(nodes, x_nodes, merged, repeated);
+    root_m = _build(merged);
+    x.root_m = x._build(repeated);
   }
 
   void erase(iterator pos) 
@@ -271,101 +448,56 @@ public:
     }
 
     Node* del = pos.node_m;
-    Node* del_parent = del->parent_m;
 
     // Case 3: Has two children:
-    //   goal: to turn into one or zero children left.
+    //   its predecessor, which has no right child, is unlinked from
+    //   its own place and relinked into del's, taking del's color and
+    //   count. No node is copied or allocated, so iterators to the
+    //   other elements stay valid.
+    // Case 1 and 2: no child or only one child:
+    //   del itself is unlinked, and the child, maybe NULL, takes its place.
+    Node* removed = del;
     if (del->left_m && del->right_m) {
-      // "Move" predecessor's value to del's by creating 
-      //    a new Node with the new value and del's old pointers;
-      Node* predecessor = _predecessor(del);
-      Node* replacement = new Node(predecessor->value_m, del_parent, del->left_m, del->right_m);
-
-      
-      if (del_parent) {
-	// Has parents
-	if (del_parent->left_m == del) {
-	  del_parent->left_m = replacement;
-	} else {
-	  del_parent->right_m = replacement;
-	}
-      } else {
-	// No parents (is root_m)
-	root_m = replacement;
-      }
-      
-      if (del->left_m) {
-	del->left_m->parent_m = replacement;
-      }
-      if (del->right_m) {
-	del->right_m->parent_m = replacement;
-      }
+      removed = _predecessor(del);
+    }
+
+    // the node left in removed's old place, and its parent.
+    Node* child = removed->left_m ? removed->left_m : removed->right_m;
+    Node* child_parent = removed->parent_m;
+    bool removed_was_red = removed->red_m;
 
-      delete del;
-      // Let erase handle unknown case for predecessor.
-      erase(iterator(this, predecessor));
-    } else if (del->left_m == NULL && del->right_m == NULL) {
-      // Case 1: No Child, simply delete.
-      if (del == root_m) {
-	// If is root
-	delete del;
-	root_m = NULL;
+    if (removed != del) {
+      if (child_parent == del) {
+	// the predecessor is del's left child: it keeps its left subtree.
+	child_parent = removed;
       } else {
-	// if not root, must have parent.
-	if (del == del_parent->left_m) {
-	  del_parent->left_m = NULL;
-	} else {
-	  del_parent->right_m = NULL;
+	_replace_child(removed, child);
+	if (child) {
+	  child->parent_m = child_parent;
 	}
-
-	delete del;
+	removed->left_m = del->left_m;
+	removed->left_m->parent_m = removed;
       }
-    } else {
-      // case 2: has only one child;
-
-      if (del == root_m) {
-	// has one child, is root.
-	Node* old_child;
-
-	if (del->left_m) {
-	  // if has left child;
-	  old_child = del->left_m;
-	} else {
-	  // Must have right child;
-	  old_child = del->right_m;
-	} 
-
-	delete root_m;
-	root_m = old_child;
-	root_m->parent_m = NULL;
 
-      } else if (del != root_m) {
-	// has one child, is not root, i.e. has parent.
-	Node* old_child;
+      _replace_child(del, removed);
+      removed->parent_m = del->parent_m;
+      removed->right_m = del->right_m;
+      removed->right_m->parent_m = removed;
+      removed->red_m = del->red_m;
+      removed->count_m = del->count_m;
+    } else {
+      _replace_child(del, child);
+      if (child) {
+	child->parent_m = child_parent;
+      }
+    }
 
-	if (del->left_m) {
-	  // if has left child;
-	  old_child = del->left_m;
-	} else {
-	  // Must have right child;
-	  old_child = del->right_m;
-	} 
+    _delete_node(del);
+    _adjust_counts(child_parent, -1);
 
-	if (del == del_parent->left_m) {
-	  // del is parent's left child;
-	  del_parent->left_m = old_child;
-	} else {
-	  // del is parent's right child;
-	  del_parent->right_m = old_child;
-	}
-       
-	old_child->parent_m = del_parent;
-	delete del;
-      } else {
-	// Exists for ultra-safety.
-	// throw runtime_error("ERROR: Impossible erase case...");
-	cerr << "ERROR: impossible erase case..." << endl;
-      }
+    // Removing a black node left its paths one black node short.
+    if (!removed_was_red) {
+      _erase_fixup(child, child_parent);
     }
   }
 
@@ -387,7 +519,7 @@ public:
   
   void clear() 
   {
-    _recursive_delete(root_m);
+    _delete_tree(root_m);
     root_m = NULL;
   }
 
@@ -414,6 +546,32 @@ public:
     }
   }
 
+  // Heterogeneous lookup: x is any type comparable to Key,
+  //   e.g. a const char* for string keys, and is not converted to Key.
+  template <class K>
+  iterator find(const K& x) 
+  {
+    pair<Node*, bool> my_pair = _find(x, root_m);
+
+    if (my_pair.second) { // Key was found.
+      return iterator(this, my_pair.first);
+    } else {
+      return end();
+    }
+  }
+
+  template <class K>
+  const_iterator find(const K& x) const 
+  {
+    pair<Node*, bool> my_pair = _find(x, root_m);
+
+    if (my_pair.second) { // Key was found.
+      return const_iterator(this, my_pair.first);
+    } else {
+      return end();
+    }
+  }
+
 
   /**
    * \brief STL Quote: "Because all elements in a map container are unique, the
@@ -439,8 +597,7 @@ public:
       return (*it).second;
     } else {               
       // not found --> create new empty
-      insert( value_type(k, T()));
-      return (*this)[k];
+      return (*insert(value_type(k, T())).first).second;
     }
   }
 
@@ -464,23 +621,351 @@ public:
     return const_iterator(this, _rightmost_node());
   }
 
+  // returns an iterator to the first element whose key is not less
+  //   than x, or end() if there is none.
+  iterator lower_bound(const Key& x)
+  {
+    return iterator(this, _lower_bound(x));
+  }
+
+  const_iterator lower_bound(const Key& x) const
+  {
+    return const_iterator(this, _lower_bound(x));
+  }
+
+  // returns an iterator to the first element whose key is greater
+  //   than x, or end() if there is none.
+  iterator upper_bound(const Key& x)
+  {
+    return iterator(this, _upper_bound(x));
+  }
+
+  const_iterator upper_bound(const Key& x) const
+  {
+    return const_iterator(this, _upper_bound(x));
+  }
+
+  // returns the elements with key x as [first, second),
+  //   empty or holding one element since keys are unique.
+  pair<iterator, iterator> equal_range(const Key& x)
+  {
+    return pair<iterator, iterator>(lower_bound(x), upper_bound(x));
+  }
+
+  pair<const_iterator, const_iterator> equal_range(const Key& x) const
+  {
+    return pair<const_iterator, const_iterator>(lower_bound(x), upper_bound(x));
+  }
+
+  // returns the elements with lo <= key <= hi as [first, second):
+  //   scanning them from first costs O(log n) plus their number.
+  pair<iterator, iterator> range(const Key& lo, const Key& hi)
+  {
+    if (hi < lo) {
+      return pair<iterator, iterator>(end(), end());
+    }
+    return pair<iterator, iterator>(lower_bound(lo), upper_bound(hi));
+  }
+
+  pair<const_iterator, const_iterator> range(const Key& lo, const Key& hi) const
+  {
+    if (hi < lo) {
+      return pair<const_iterator, const_iterator>(end(), end());
+    }
+    return pair<const_iterator, const_iterator>(lower_bound(lo), upper_bound(hi));
+  }
+
+  // returns the number of keys less than x, in O(log n).
+  size_type rank(const Key& x) const
+  {
+    return _count_below(x, false);
+  }
+
+  // returns an iterator to the element of rank i, i.e. the (i + 1)th
+  //   smallest, or end() if i >= size(), in O(log n).
+  iterator select(size_type i)
+  {
+    Node* n = _select(i);
+    return n ? iterator(this, n) : end();
+  }
+
+  const_iterator select(size_type i) const
+  {
+    Node* n = _select(i);
+    return n ? const_iterator(this, n) : end();
+  }
+
+  // returns the number of keys k with lo <= k <= hi, in O(log n).
+  size_type count_range(const Key& lo, const Key& hi) const
+  {
+    if (hi < lo) {
+      return 0;
+    }
+
+    return _count_below(hi, true) - _count_below(lo, false);
+  }
+
   // Private functions for internal helping.
 private:
   // Finds a Node from given key and subtree.
   //   returns a Node pointer and bool pair
   //   bool holds if given key was found in map.
-  pair<Node*, bool> _find(const key_type& key, Node* const subtree, Node* const parent = NULL) const 
+  //   Iterative, so a deep tree cannot overflow the stack.
+  template <class K>
+  pair<Node*, bool> _find(const K& key, Node* subtree, Node* parent = NULL) const 
+  {
+    while (subtree != NULL) {
+      if (subtree->value_m.first == key) {
+	return pair<Node*, bool>(subtree, true);
+      }
+
+      parent = subtree;
+      if (subtree->value_m.first > key) {
+	subtree = subtree->left_m;
+      } else {
+	subtree = subtree->right_m;
+      }
+    }
+
+    return pair<Node*, bool>(parent, false);
+  }
+
+  // Finds where key goes starting from the node hint (NULL for end()):
+  //   the node with key and true, or the parent to hang a new node from
+  //   (NULL if the map is empty) and false. Only the hint's neighbors
+  //   are compared against key; if key is not between them, it is
+  //   looked up from the root.
+  pair<Node*, bool> _find_hint(const Key& key, Node* const hint) const
+  {
+    if (root_m == NULL) {
+      return pair<Node*, bool>(NULL, false);
+    }
+
+    if (hint == NULL) {
+      // after the last element
+      Node* last = _rightmost_node();
+      if (last->value_m.first < key) {
+	return pair<Node*, bool>(last, false);
+      }
+    } else if (key < hint->value_m.first) {
+      // between hint's predecessor and hint: the free slot is hint's
+      //   left child, or else the right child of its predecessor.
+      Node* prev = _predecessor(hint);
+      if (prev == NULL || prev->value_m.first < key) {
+	return pair<Node*, bool>(hint->left_m ? prev : hint, false);
+      }
+    } else if (hint->value_m.first < key) {
+      // between hint and its successor, likewise.
+      Node* next = _successor(hint);
+      if (next == NULL || key < next->value_m.first) {
+	return pair<Node*, bool>(hint->right_m ? next : hint, false);
+      }
+    } else {
+      return pair<Node*, bool>(hint, true);
+    }
+
+    return _find(key, root_m);
+  }
+
+  // Hangs the new node n from its parent_m, on the side its key goes
+  //   (or makes it the root), then counts it and rebalances.
+  void _link_new(Node* const n)
   {
-    if (subtree == NULL) {
-      return pair<Node*, bool>(parent, false);
-    } 
+    Node* parent = n->parent_m;
 
-    if (subtree->value_m.first == key) {
-      return pair<Node*, bool>(subtree, true);
-    } else if (subtree->value_m.first > key) {
-      return _find(key, subtree->left_m, subtree);
+    if (parent == NULL) {
+      // First Node insertaion
+      root_m = n;
+    } else if (n->value_m.first < parent->value_m.first) {
+      parent->left_m = n;
     } else {
-      return _find(key, subtree->right_m, subtree);
+      parent->right_m = n;
+    }
+
+    _adjust_counts(parent, 1);
+    // Rotations move nodes, not values, so n stays valid.
+    _insert_fixup(n);
+  }
+
+  // Puts child in n's place under n's parent (or as the root).
+  //   The caller sets child's parent_m.
+  void _replace_child(Node* const n, Node* const child)
+  {
+    Node* parent = n->parent_m;
+
+    if (parent == NULL) {
+      root_m = child;
+    } else if (parent->left_m == n) {
+      parent->left_m = child;
+    } else {
+      parent->right_m = child;
+    }
+  }
+
+  // Rotates n down to the left: its right child takes its place.
+  void _rotate_left(Node* const n)
+  {
+    Node* pivot = n->right_m;
+
+    n->right_m = pivot->left_m;
+    if (pivot->left_m) {
+      pivot->left_m->parent_m = n;
+    }
+
+    _replace_child(n, pivot);
+    pivot->parent_m = n->parent_m;
+    pivot->left_m = n;
+    n->parent_m = pivot;
+
+    // pivot now roots what n rooted.
+    pivot->count_m = n->count_m;
+    _recount(n);
+  }
+
+  // Rotates n down to the right: its left child takes its place.
+  void _rotate_right(Node* const n)
+  {
+    Node* pivot = n->left_m;
+
+    n->left_m = pivot->right_m;
+    if (pivot->right_m) {
+      pivot->right_m->parent_m = n;
+    }
+
+    _replace_child(n, pivot);
+    pivot->parent_m = n->parent_m;
+    pivot->right_m = n;
+    n->parent_m = pivot;
+
+    // pivot now roots what n rooted.
+    pivot->count_m = n->count_m;
+    _recount(n);
+  }
+
+  // NULL leaves count as black.
+  static bool _is_red(const Node* const n)
+  {
+    return n != NULL && n->red_m;
+  }
+
+  // Restores the red-black rules after inserting the red node n:
+  //   while n's parent is red too, recolor if n's uncle is red,
+  //   otherwise rotate n's grandparent once or twice and stop.
+  void _insert_fixup(Node* n)
+  {
+    while (_is_red(n->parent_m)) {
+      // a red parent is never the root, so the grandparent exists.
+      Node* parent = n->parent_m;
+      Node* grandparent = parent->parent_m;
+
+      if (parent == grandparent->left_m) {
+	Node* uncle = grandparent->right_m;
+
+	if (_is_red(uncle)) {
+	  parent->red_m = false;
+	  uncle->red_m = false;
+	  grandparent->red_m = true;
+	  n = grandparent;
+	} else {
+	  if (n == parent->right_m) {
+	    n = parent;
+	    _rotate_left(n);
+	    parent = n->parent_m;
+	  }
+	  parent->red_m = false;
+	  grandparent->red_m = true;
+	  _rotate_right(grandparent);
+	}
+      } else {
+	Node* uncle = grandparent->left_m;
+
+	if (_is_red(uncle)) {
+	  parent->red_m = false;
+	  uncle->red_m = false;
+	  grandparent->red_m = true;
+	  n = grandparent;
+	} else {
+	  if (n == parent->left_m) {
+	    n = parent;
+	    _rotate_right(n);
+	    parent = n->parent_m;
+	  }
+	  parent->red_m = false;
+	  grandparent->red_m = true;
+	  _rotate_left(grandparent);
+	}
+      }
+    }
+
+    root_m->red_m = false;
+  }
+
+  // Restores the red-black rules after a black node was removed from
+  //   under parent, leaving n (maybe NULL) in its place one black short:
+  //   borrow a black from n's sibling's side by recoloring and rotating,
+  //   or push the shortage up to parent.
+  void _erase_fixup(Node* n, Node* parent)
+  {
+    while (n != root_m && !_is_red(n)) {
+      if (n == parent->left_m) {
+	Node* sibling = parent->right_m;
+
+	if (_is_red(sibling)) {
+	  sibling->red_m = false;
+	  parent->red_m = true;
+	  _rotate_left(parent);
+	  sibling = parent->right_m;
+	}
+
+	if (!_is_red(sibling->left_m) && !_is_red(sibling->right_m)) {
+	  sibling->red_m = true;
+	  n = parent;
+	  parent = n->parent_m;
+	} else {
+	  if (!_is_red(sibling->right_m)) {
+	    sibling->left_m->red_m = false;
+	    sibling->red_m = true;
+	    _rotate_right(sibling);
+	    sibling = parent->right_m;
+	  }
+	  sibling->red_m = parent->red_m;
+	  parent->red_m = false;
+	  sibling->right_m->red_m = false;
+	  _rotate_left(parent);
+	  n = root_m;
+	}
+      } else {
+	Node* sibling = parent->left_m;
+
+	if (_is_red(sibling)) {
+	  sibling->red_m = false;
+	  parent->red_m = true;
+	  _rotate_right(parent);
+	  sibling = parent->left_m;
+	}
+
+	if (!_is_red(sibling->left_m) && !_is_red(sibling->right_m)) {
+	  sibling->red_m = true;
+	  n = parent;
+	  parent = n->parent_m;
+	} else {
+	  if (!_is_red(sibling->left_m)) {
+	    sibling->right_m->red_m = false;
+	    sibling->red_m = true;
+	    _rotate_left(sibling);
+	    sibling = parent->left_m;
+	  }
+	  sibling->red_m = parent->red_m;
+	  parent->red_m = false;
+	  sibling->left_m->red_m = false;
+	  _rotate_right(parent);
+	  n = root_m;
+	}
+      }
+    }
+
+    if (n) {
+      n->red_m = false;
     }
   }
 
@@ -549,46 +1034,289 @@ private:
     }
   }
 
-  // Predecessor is the largest element in the left subtree from n.
+  // returns the predecessor of a Node, NULL for the leftmost one.
   Node* _predecessor(Node* const n) const
   {
     if (n == NULL) {
       // throw runtime_error("Cannot predecess NULL");
       cerr << "Cannot predecess NULL" << endl;
-    } else if (n == _leftmost_node()) { 
-      // throw runtime_error("Cannot predecess lowest node.");
-      cerr << "Cannot predecess lowest node" << endl;
     }
-    
+
+    // If node has a left child,
+    //   predecessor is the max(node.left)
     if (n->left_m) {
-      // Predecessor is the largest element in left subtree.
       return _rightmost_node(n->left_m);
     } else {
-      return n->parent_m;
+      Node* curr = n;
+      Node* parent = n->parent_m;
+
+      // predecessor is the parent where node is left child of parent.
+      while (parent != NULL && curr == parent->left_m) {
+	curr = parent;
+	parent = parent->parent_m;
+      }
+
+      return parent;
+    }
+  }
+
+  // Deletes the tree rooted at n, which has no parent, children first.
+  //   Iterative: climbs back up through the parent links, unhooking each
+  //   node from its parent as it goes, so it needs no stack.
+  void _delete_tree(Node* n)
+  {
+    while (n != NULL) {
+      if (n->left_m) {
+	n = n->left_m;
+      } else if (n->right_m) {
+	n = n->right_m;
+      } else {
+	Node* parent = n->parent_m;
+
+	if (parent) {
+	  if (parent->left_m == n) {
+	    parent->left_m = NULL;
+	  } else {
+	    parent->right_m = NULL;
+	  }
+	}
+	_delete_node(n);
+	n = parent;
+      }
     }
   }
 
-  // recursively delete left, then right, then myself.
-  void _recursive_delete(Node* n) 
+  // Copies the subtree n under parent, node by node with colors and
+  //   counts. Iterative: walks n in preorder through the parent links,
+  //   with the copy's node in step, and a child not yet copied is one
+  //   still NULL in the copy.
+  Node* _clone(const Node* const n, Node* const parent)
   {
-    if (n != NULL) {
-      _recursive_delete(n->left_m);
-      _recursive_delete(n->right_m);
+    if (n == NULL) {
+      return NULL;
+    }
 
-      delete n;
-      n = NULL;
+    Node* copy = _clone_node(n, parent);
+    const Node* from = n;
+    Node* to = copy;
+
+    while (true) {
+      if (from->left_m && to->left_m == NULL) {
+	to->left_m = _clone_node(from->left_m, to);
+	from = from->left_m;
+	to = to->left_m;
+      } else if (from->right_m && to->right_m == NULL) {
+	to->right_m = _clone_node(from->right_m, to);
+	from = from->right_m;
+	to = to->right_m;
+      } else if (from == n) {
+	break;
+      } else {
+	from = from->parent_m;
+	to = to->parent_m;
+      }
     }
+
+    return copy;
   }
 
-  // Gets size of left tree + right tree + 1 (root)
-  size_type _size(Node* const n) const 
+  // Copies a single node, with its color and count, under parent.
+  Node* _clone_node(const Node* const n, Node* const parent)
+  {
+    Node* copy = _new_node(n->value_m, parent);
+    copy->red_m = n->red_m;
+    copy->count_m = n->count_m;
+    return copy;
+  }
+
+  // Appends the nodes of the subtree n to nodes, in key order.
+  void _flatten(Node* const n, vector<Node*>& nodes) const
   {
     if (n == NULL) {
-      return 0;
-    } else {
-      // root + size(left), + size(right)
-      return 1 + _size(n->left_m) + _size(n->right_m);
+      return;
     }
+
+    nodes.reserve(nodes.size() + n->count_m);
+    Node* last = _rightmost_node(n);
+    for (Node* curr = _leftmost_node(n); ; curr = _successor(curr)) {
+      nodes.push_back(curr);
+      if (curr == last) {
+	break;
+      }
+    }
+  }
+
+  // Merges two runs of nodes in key order into merged; a node of b
+  //   whose key is also in a goes to repeated instead.
+  static void _merge_nodes(const vector<Node*>& a, const vector<Node*>& b,
+			   vector<Node*>& merged, vector<Node*>& repeated)
+  {
+    size_t i = 0;
+    size_t j = 0;
+
+    merged.reserve(a.size() + b.size());
+    while (i < a.size() && j < b.size()) {
+      if (a[i]->value_m.first < b[j]->value_m.first) {
+	merged.push_back(a[i++]);
+      } else if (b[j]->value_m.first < a[i]->value_m.first) {
+	merged.push_back(b[j++]);
+      } else {
+	merged.push_back(a[i++]);
+	repeated.push_back(b[j++]);
+      }
+    }
+    merged.insert(merged.end(), a.begin() + i, a.end());
+    merged.insert(merged.end(), b.begin() + j, b.end());
+  }
+
+  // Relinks nodes, in key order, into a perfectly balanced tree and
+  //   returns its root. Every level is black but an incomplete bottom
+  //   one, which is red, so all paths keep the same black height.
+  Node* _build(const vector<Node*>& nodes)
+  {
+    size_type red_depth = 0;
+    while ((size_type(2) << red_depth) <= nodes.size() + 1) {
+      ++red_depth;
+    }
+
+    return _build(nodes.empty() ? NULL : &nodes[0], nodes.size(), NULL, 0, red_depth);
+  }
+
+  // Makes the middle of n nodes the root of the subtree under parent,
+  //   at the given depth, and recurses on both halves: O(log n) deep.
+  static Node* _build(Node* const* nodes, size_type n, Node* const parent,
+		      size_type depth, size_type red_depth)
+  {
+    if (n == 0) {
+      return NULL;
+    }
+
+    size_type middle = n / 2;
+    Node* root = nodes[middle];
+
+    root->parent_m = parent;
+    root->red_m = (depth == red_depth);
+    root->count_m = n;
+    root->left_m = _build(nodes, middle, root, depth + 1, red_depth);
+    root->right_m = _build(nodes + middle + 1, n - middle - 1, root, depth + 1, red_depth);
+    return root;
+  }
+
+  // Allocates and builds a node from args.
+  template <class... Args>
+  Node* _new_node(Args&&... args)
+  {
+    Node* n = alloc_m.allocate(1);
+    try {
+      ::new (static_cast<void*>(n)) Node(std::forward<Args>(args)...);
+    } catch (...) {
+      alloc_m.deallocate(n, 1);
+      throw;
+    }
+    return n;
+  }
+
+  // Destroys and frees a node from _new_node().
+  void _delete_node(Node* n)
+  {
+    n->~Node();
+    alloc_m.deallocate(n, 1);
+  }
+
+  // Gets the number of nodes in the subtree of n, 0 for NULL.
+  static size_type _count(const Node* const n)
+  {
+    return n ? n->count_m : 0;
+  }
+
+  // Recomputes n's count from its children's.
+  static void _recount(Node* const n)
+  {
+    n->count_m = 1 + _count(n->left_m) + _count(n->right_m);
+  }
+
+  // Adds delta to the count of n and of each of its ancestors.
+  static void _adjust_counts(Node* n, int delta)
+  {
+    for (; n != NULL; n = n->parent_m) {
+      n->count_m += delta;
+    }
+  }
+
+  // Counts the keys less than key, or not greater if inclusive,
+  //   adding up the left subtrees passed on the way down.
+  size_type _count_below(const Key& key, bool inclusive) const
+  {
+    size_type below = 0;
+    Node* n = root_m;
+
+    while (n != NULL) {
+      if (n->value_m.first < key || (inclusive && n->value_m.first == key)) {
+	below += 1 + _count(n->left_m);
+	n = n->right_m;
+      } else {
+	n = n->left_m;
+      }
+    }
+
+    return below;
+  }
+
+  // Finds the first node whose key is not less than key, NULL if none.
+  Node* _lower_bound(const Key& key) const
+  {
+    Node* bound = NULL;
+    Node* n = root_m;
+
+    while (n != NULL) {
+      if (n->value_m.first < key) {
+	n = n->right_m;
+      } else {
+	bound = n;
+	n = n->left_m;
+      }
+    }
+
+    return bound;
+  }
+
+  // Finds the first node whose key is greater than key, NULL if none.
+  Node* _upper_bound(const Key& key) const
+  {
+    Node* bound = NULL;
+    Node* n = root_m;
+
+    while (n != NULL) {
+      if (key < n->value_m.first) {
+	bound = n;
+	n = n->left_m;
+      } else {
+	n = n->right_m;
+      }
+    }
+
+    return bound;
+  }
+
+  // Finds the node of rank i, NULL if i >= size().
+  Node* _select(size_type i) const
+  {
+    Node* n = root_m;
+
+    while (n != NULL) {
+      size_type left = _count(n->left_m);
+
+      if (i < left) {
+	n = n->left_m;
+      } else if (i == left) {
+	return n;
+      } else {
+	i -= left + 1;
+	n = n->right_m;
+      }
+    }
+
+    return NULL;
   }
 };
 
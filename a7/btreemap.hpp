@@ -0,0 +1,1017 @@
+#ifndef BTREEMAP_HPP
+#define BTREEMAP_HPP
+
+/**
+ * \file btreemap.hpp
+ *
+ * Creates a B-tree Map: an ordered map with the interface of bstmap, but
+ * whose nodes each hold up to 2t - 1 elements in contiguous arrays
+ * instead of one. A lookup compares against a few cache lines of keys
+ * per level, and the tree is only log_t(n) levels deep, so large maps
+ * are searched and scanned in order with far fewer cache misses.
+ * Every node counts the elements of its subtree, for an O(1) size() and
+ * O(t log_t n) order statistics: rank(), select() and count_range().
+ *
+ * Unlike bstmap, elements move between nodes when the tree changes:
+ * insert() and erase() invalidate every iterator.
+ */
+
+
+#include <utility>
+#include <cstddef>
+#include <iterator>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "poolallocator.hpp"
+
+using namespace std;
+
+/**
+ * \class btreemap
+ * \brief Class btreemap
+ *
+ * Nodes are allocated with Alloc rebound to the node types; the default
+ * pool_allocator recycles them instead of calling malloc every time.
+ * Each key is stored twice: in the contiguous array searched on the way
+ * down, and in the element handed out by the iterators.
+ */
+template <class Key, class T, class Alloc = pool_allocator<pair<const Key, T> > >
+class btreemap
+{
+  typedef btreemap<Key, T, Alloc> Self;
+
+public:
+  typedef Key                key_type;
+  typedef T                  data_type;
+  typedef pair<const Key, T> value_type;
+  typedef unsigned int       size_type;
+  typedef int                difference_type;
+  typedef Alloc              allocator_type;
+
+private:
+  // minimum degree t: nodes but the root hold t - 1 to 2t - 1 keys,
+  //   enough for the keys of a node to span about four cache lines.
+  //   Wider nodes make a shallower tree, and each level down costs a
+  //   cache miss or two however wide it is.
+  static const size_type MIN_DEGREE = 128 / sizeof(Key) > 3 ? 128 / sizeof(Key) : 3;
+  static const size_type MAX_KEYS = 2 * MIN_DEGREE - 1;
+  static const size_type MIN_KEYS = MIN_DEGREE - 1;
+
+  class Internal;
+
+  /**
+   * \class Leaf
+   * \brief A node without children; an Internal node extends it.
+   *
+   * Slots [0, size_m) of keys_m and values_m are constructed, the rest
+   * are raw storage.
+   */
+  class Leaf {
+  public:
+    Leaf() : parent_m(NULL), count_m(0), size_m(0), index_m(0), leaf_m(true) {}
+
+    Key& key(size_type i)
+    {
+      return *reinterpret_cast<Key*>(&keys_m[i]);
+    }
+
+    value_type& value(size_type i)
+    {
+      return *reinterpret_cast<value_type*>(&values_m[i]);
+    }
+
+    Internal* parent_m;
+    // number of elements in the subtree rooted here, these included.
+    size_type count_m;
+    // number of elements in this node.
+    unsigned short size_m;
+    // position of this node among its parent's children.
+    unsigned short index_m;
+    bool leaf_m;
+    typename aligned_storage<sizeof(Key), alignof(Key)>::type keys_m[MAX_KEYS];
+    typename aligned_storage<sizeof(value_type), alignof(value_type)>::type values_m[MAX_KEYS];
+  };
+
+  /**
+   * \class Internal
+   * \brief A node with size_m + 1 children: child i holds the keys
+   * between key(i - 1) and key(i).
+   */
+  class Internal : public Leaf {
+  public:
+    Internal()
+    {
+      this->leaf_m = false;
+    }
+
+    Leaf* children_m[MAX_KEYS + 1];
+  };
+
+  typedef typename allocator_traits<Alloc>::template rebind_alloc<Leaf> leaf_allocator;
+  typedef typename allocator_traits<Alloc>::template rebind_alloc<Internal> internal_allocator;
+
+  Leaf* root_m;
+
+  // allocate the nodes.
+  leaf_allocator leaf_alloc_m;
+  internal_allocator internal_alloc_m;
+
+public:
+  template<typename _T>
+  class _iterator
+  {
+  public:
+    typedef input_iterator_tag iterator_category;
+    typedef _T value_type;
+    typedef int difference_type;
+    typedef value_type* pointer;
+    typedef value_type& reference;
+
+    friend class btreemap;
+
+    _iterator() : map_m(NULL), node_m(NULL), index_m(0) {}
+    _iterator(const btreemap* map, Leaf* n = NULL, size_type i = 0)
+      : map_m(map), node_m(n), index_m(i) {}
+
+    reference operator*() const
+    {
+      if (node_m == NULL) {
+	cerr << "ERROR: Cannot access Node; Node is NULL" << endl;
+      }
+
+      return node_m->value(index_m);
+    }
+
+    pointer operator->() const
+    {
+      return &(**this);
+    }
+
+    friend bool operator==(const _iterator& x, const _iterator& y)
+    {
+      return x.node_m == y.node_m && x.index_m == y.index_m;
+    }
+
+    friend bool operator!=(const _iterator& x, const _iterator& y)
+    {
+      return !(x == y);
+    }
+
+    // moves to the next element in key order: down to the leftmost leaf
+    //   right of this key, along the leaf, or up past a last child.
+    _iterator operator++()
+    {
+      if (node_m == NULL) {
+	cerr << "Cannot success NULL" << endl;
+	return *this;
+      }
+
+      if (!node_m->leaf_m) {
+	node_m = btreemap::_leftmost_leaf(static_cast<Internal*>(node_m)->children_m[index_m + 1]);
+	index_m = 0;
+      } else if (++index_m >= node_m->size_m) {
+	do {
+	  index_m = node_m->index_m;
+	  node_m = node_m->parent_m;
+	} while (node_m != NULL && index_m >= node_m->size_m);
+
+	if (node_m == NULL) {
+	  index_m = 0;
+	}
+      }
+
+      return *this;
+    }
+
+    _iterator operator++(int)
+    {
+      _iterator temp = *this;
+      ++(*this);
+      return temp;
+    }
+
+  private:
+    const btreemap* map_m;
+    Leaf* node_m;
+    size_type index_m;
+  };
+
+  typedef _iterator<value_type> iterator;
+  typedef _iterator<const value_type> const_iterator;
+
+public:
+  // default constructor to create an empty map
+  btreemap() : root_m(NULL) {}
+
+  // builds a map from a range of values; each sorted value lands at the
+  //   end of the rightmost leaf.
+  template <class InputIterator>
+  btreemap(InputIterator first, InputIterator last)
+    : root_m(NULL)
+  {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  ~btreemap()
+  {
+    clear();
+  }
+
+  // overload copy constructor to do a deep copy, node by node
+  btreemap(const Self& x)
+    : root_m(NULL), leaf_alloc_m(x.leaf_alloc_m), internal_alloc_m(x.internal_alloc_m)
+  {
+    root_m = _clone(x.root_m, NULL, 0);
+  }
+
+  // move constructor: takes x's nodes, leaving x empty
+  btreemap(Self&& x) noexcept
+    : root_m(x.root_m), leaf_alloc_m(x.leaf_alloc_m), internal_alloc_m(x.internal_alloc_m)
+  {
+    x.root_m = NULL;
+  }
+
+  // overload assignment to do a deep copy
+  Self& operator=(const Self& x)
+  {
+    // guard against self assignment
+    if (this == &x) {
+      return (*this);
+    }
+
+    clear();
+    root_m = _clone(x.root_m, NULL, 0);
+    return (*this);
+  }
+
+  // move assignment: takes x's nodes, leaving x empty
+  Self& operator=(Self&& x) noexcept
+  {
+    if (this != &x) {
+      clear();
+      leaf_alloc_m = x.leaf_alloc_m;
+      internal_alloc_m = x.internal_alloc_m;
+      root_m = x.root_m;
+      x.root_m = NULL;
+    }
+    return (*this);
+  }
+
+  // exchanges the contents of two maps in O(1)
+  void swap(Self& x) noexcept
+  {
+    Leaf* temp = root_m;
+    root_m = x.root_m;
+    x.root_m = temp;
+
+    leaf_allocator temp_leaf_alloc = leaf_alloc_m;
+    leaf_alloc_m = x.leaf_alloc_m;
+    x.leaf_alloc_m = temp_leaf_alloc;
+
+    internal_allocator temp_internal_alloc = internal_alloc_m;
+    internal_alloc_m = x.internal_alloc_m;
+    x.internal_alloc_m = temp_internal_alloc;
+  }
+
+  // returns a copy of the allocator.
+  allocator_type get_allocator() const
+  {
+    return allocator_type(leaf_alloc_m);
+  }
+
+  // accessors:
+  iterator begin()
+  {
+    return iterator(this, _leftmost_leaf(root_m));
+  }
+
+  const_iterator begin() const
+  {
+    return const_iterator(this, _leftmost_leaf(root_m));
+  }
+
+  iterator end()
+  {
+    // Null wrapper. "Point past-the-end", also begin() if empty.
+    return iterator(this, NULL);
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator(this, NULL);
+  }
+
+  bool empty() const
+  {
+    return root_m == NULL;
+  }
+
+  size_type size() const
+  {
+    return root_m ? root_m->count_m : 0;
+  }
+
+  pair<iterator, bool> insert(const value_type& x)
+  {
+    Leaf* n;
+    size_type i;
+
+    if (_find(x.first, n, i)) {
+      // means value is already in tree
+      return pair<iterator, bool>(iterator(this, n, i), false);
+    }
+
+    return pair<iterator, bool>(_insert_leaf(n, i, x), true);
+  }
+
+  void erase(iterator pos)
+  {
+    if (pos.node_m == NULL) {
+      // throw runtime_error("Cannot erase NULL");
+      cerr << "ERROR: Cannot erase NULL" << endl;
+      return;
+    }
+
+    Leaf* n = pos.node_m;
+    size_type i = pos.index_m;
+
+    if (!n->leaf_m) {
+      // An element of an internal node is replaced by its predecessor,
+      //   the last element of a leaf, which is erased there instead.
+      Leaf* leaf = _rightmost_leaf(static_cast<Internal*>(n)->children_m[i]);
+
+      _destroy(n, i);
+      _relocate(leaf, leaf->size_m - 1, n, i);
+      n = leaf;
+    } else {
+      _destroy(n, i);
+      for (size_type j = i + 1; j < n->size_m; ++j) {
+	_relocate(n, j, n, j - 1);
+      }
+    }
+
+    --n->size_m;
+    _adjust_counts(n, -1);
+    _rebalance(n);
+  }
+
+  // return number of given keys deleted
+  //   should either be 0 or 1 in btreemap.
+  size_type erase(const Key& x)
+  {
+    iterator it(find(x));
+
+    if (it == end()) {
+      // Key not found
+      return 0;
+    } else {
+      erase(it);
+      // since Key in btreemaps are unique, can only be 1
+      return 1;
+    }
+  }
+
+  void clear()
+  {
+    _recursive_delete(root_m);
+    root_m = NULL;
+  }
+
+  // map operations:
+  // Heterogeneous lookup: x is any type comparable to Key,
+  //   e.g. a const char* for string keys, and is not converted to Key.
+  template <class K>
+  iterator find(const K& x)
+  {
+    Leaf* n;
+    size_type i;
+
+    if (_find(x, n, i)) { // Key was found.
+      return iterator(this, n, i);
+    } else {
+      return end();
+    }
+  }
+
+  template <class K>
+  const_iterator find(const K& x) const
+  {
+    Leaf* n;
+    size_type i;
+
+    if (_find(x, n, i)) { // Key was found.
+      return const_iterator(this, n, i);
+    } else {
+      return end();
+    }
+  }
+
+  size_type count(const Key& x) const
+  {
+    // find(x) returns end() if not found.
+    if (find(x) != end()) {
+      return 1;
+    } else {
+      return 0;
+    }
+  }
+
+  T& operator[](const Key& k)
+  {
+    iterator it = find(k);
+
+    if (it != end()) {
+      // found key
+      return (*it).second;
+    } else {
+      // not found --> create new empty
+      return (*insert(value_type(k, T())).first).second;
+    }
+  }
+
+  iterator min()
+  {
+    return begin();
+  }
+
+  const_iterator min() const
+  {
+    return begin();
+  }
+
+  iterator max()
+  {
+    Leaf* n = _rightmost_leaf(root_m);
+    return iterator(this, n, n ? n->size_m - 1 : 0);
+  }
+
+  const_iterator max() const
+  {
+    Leaf* n = _rightmost_leaf(root_m);
+    return const_iterator(this, n, n ? n->size_m - 1 : 0);
+  }
+
+  // returns an iterator to the first element whose key is not less
+  //   than x, or end() if there is none.
+  iterator lower_bound(const Key& x)
+  {
+    return _bound<iterator>(x, false);
+  }
+
+  const_iterator lower_bound(const Key& x) const
+  {
+    return _bound<const_iterator>(x, false);
+  }
+
+  // returns an iterator to the first element whose key is greater
+  //   than x, or end() if there is none.
+  iterator upper_bound(const Key& x)
+  {
+    return _bound<iterator>(x, true);
+  }
+
+  const_iterator upper_bound(const Key& x) const
+  {
+    return _bound<const_iterator>(x, true);
+  }
+
+  // returns the elements with key x as [first, second),
+  //   empty or holding one element since keys are unique.
+  pair<iterator, iterator> equal_range(const Key& x)
+  {
+    return pair<iterator, iterator>(lower_bound(x), upper_bound(x));
+  }
+
+  pair<const_iterator, const_iterator> equal_range(const Key& x) const
+  {
+    return pair<const_iterator, const_iterator>(lower_bound(x), upper_bound(x));
+  }
+
+  // returns the elements with lo <= key <= hi as [first, second):
+  //   scanning them from first costs O(log n) plus their number.
+  pair<iterator, iterator> range(const Key& lo, const Key& hi)
+  {
+    if (hi < lo) {
+      return pair<iterator, iterator>(end(), end());
+    }
+    return pair<iterator, iterator>(lower_bound(lo), upper_bound(hi));
+  }
+
+  pair<const_iterator, const_iterator> range(const Key& lo, const Key& hi) const
+  {
+    if (hi < lo) {
+      return pair<const_iterator, const_iterator>(end(), end());
+    }
+    return pair<const_iterator, const_iterator>(lower_bound(lo), upper_bound(hi));
+  }
+
+  // returns the number of keys less than x.
+  size_type rank(const Key& x) const
+  {
+    return _count_below(x, false);
+  }
+
+  // returns an iterator to the element of rank i, i.e. the (i + 1)th
+  //   smallest, or end() if i >= size().
+  iterator select(size_type i)
+  {
+    Leaf* n;
+    size_type j;
+    _select(i, n, j);
+    return iterator(this, n, j);
+  }
+
+  const_iterator select(size_type i) const
+  {
+    Leaf* n;
+    size_type j;
+    _select(i, n, j);
+    return const_iterator(this, n, j);
+  }
+
+  // returns the number of keys k with lo <= k <= hi.
+  size_type count_range(const Key& lo, const Key& hi) const
+  {
+    if (hi < lo) {
+      return 0;
+    }
+
+    return _count_below(hi, true) - _count_below(lo, false);
+  }
+
+  // Private functions for internal helping.
+private:
+  // Finds the first slot of n whose key is not less than key, or,
+  //   if after, greater than key: a binary search of the key array
+  //   that halves its range without a branch, so it does not stall on
+  //   mispredicted comparisons.
+  template <class K>
+  static size_type _search(Leaf* const n, const K& key, bool after = false)
+  {
+    size_type base = 0;
+    size_type length = n->size_m;
+
+    if (length == 0) {
+      return 0;
+    }
+
+    while (length > 1) {
+      size_type half = length / 2;
+      bool go_right = after ? !(key < n->key(base + half - 1)) : n->key(base + half - 1) < key;
+
+      base += go_right ? half : 0;
+      length -= half;
+    }
+
+    bool go_right = after ? !(key < n->key(base)) : n->key(base) < key;
+    return base + go_right;
+  }
+
+  // Finds key from the root down, setting n and i to its slot and
+  //   returning true, or to the leaf slot where it belongs and
+  //   returning false (n is NULL if the map is empty).
+  template <class K>
+  bool _find(const K& key, Leaf*& n, size_type& i) const
+  {
+    n = root_m;
+    i = 0;
+
+    while (n != NULL) {
+      i = _search(n, key);
+      if (i < n->size_m && !(key < n->key(i))) {
+	return true;
+      }
+      if (n->leaf_m) {
+	return false;
+      }
+      n = static_cast<Internal*>(n)->children_m[i];
+    }
+
+    return false;
+  }
+
+  // Finds the first element whose key is not less than key, or greater
+  //   if after: the last candidate met on the way down is the smallest.
+  template <class Iterator>
+  Iterator _bound(const Key& key, bool after) const
+  {
+    Leaf* bound = NULL;
+    size_type bound_index = 0;
+    Leaf* n = root_m;
+
+    while (n != NULL) {
+      size_type i = _search(n, key, after);
+
+      if (i < n->size_m) {
+	bound = n;
+	bound_index = i;
+      }
+      n = n->leaf_m ? NULL : static_cast<Internal*>(n)->children_m[i];
+    }
+
+    return Iterator(this, bound, bound_index);
+  }
+
+  // Counts the keys less than key, or not greater if inclusive,
+  //   adding up the keys and subtrees left of the path down.
+  size_type _count_below(const Key& key, bool inclusive) const
+  {
+    size_type below = 0;
+    Leaf* n = root_m;
+
+    while (n != NULL) {
+      size_type i = _search(n, key, inclusive);
+
+      below += i;
+      if (n->leaf_m) {
+	break;
+      }
+
+      Internal* in = static_cast<Internal*>(n);
+      for (size_type j = 0; j < i; ++j) {
+	below += in->children_m[j]->count_m;
+      }
+      n = in->children_m[i];
+    }
+
+    return below;
+  }
+
+  // Finds the element of rank i, setting n to NULL if i >= size().
+  void _select(size_type i, Leaf*& n, size_type& j) const
+  {
+    n = (i < size()) ? root_m : NULL;
+    j = 0;
+
+    while (n != NULL && !n->leaf_m) {
+      Internal* in = static_cast<Internal*>(n);
+      size_type k = 0;
+
+      // skip the children and keys wholly before rank i.
+      while (i >= in->children_m[k]->count_m) {
+	i -= in->children_m[k]->count_m;
+	if (i == 0) {
+	  j = k;
+	  return;
+	}
+	--i;
+	++k;
+      }
+      n = in->children_m[k];
+    }
+
+    j = n ? i : 0;
+  }
+
+  // Returns the leftmost leaf under n, NULL if n is.
+  static Leaf* _leftmost_leaf(Leaf* n)
+  {
+    while (n != NULL && !n->leaf_m) {
+      n = static_cast<Internal*>(n)->children_m[0];
+    }
+    return n;
+  }
+
+  // Returns the rightmost leaf under n, NULL if n is.
+  static Leaf* _rightmost_leaf(Leaf* n)
+  {
+    while (n != NULL && !n->leaf_m) {
+      n = static_cast<Internal*>(n)->children_m[n->size_m];
+    }
+    return n;
+  }
+
+  // Builds the element and its key copy in the raw slot i of n.
+  static void _construct(Leaf* const n, size_type i, const value_type& x)
+  {
+    ::new (static_cast<void*>(&n->values_m[i])) value_type(x);
+    try {
+      ::new (static_cast<void*>(&n->keys_m[i])) Key(x.first);
+    } catch (...) {
+      n->value(i).~value_type();
+      throw;
+    }
+  }
+
+  // Destroys the element in slot i of n, leaving it raw.
+  static void _destroy(Leaf* const n, size_type i)
+  {
+    n->value(i).~value_type();
+    n->key(i).~Key();
+  }
+
+  // Moves the element in slot i of from to the raw slot j of to.
+  static void _relocate(Leaf* const from, size_type i, Leaf* const to, size_type j)
+  {
+    ::new (static_cast<void*>(&to->values_m[j])) value_type(std::move(from->value(i)));
+    ::new (static_cast<void*>(&to->keys_m[j])) Key(std::move(from->key(i)));
+    _destroy(from, i);
+  }
+
+  // Makes child the i-th child of parent.
+  static void _set_child(Internal* const parent, size_type i, Leaf* const child)
+  {
+    parent->children_m[i] = child;
+    child->parent_m = parent;
+    child->index_m = i;
+  }
+
+  // Recomputes n's count from its elements and children.
+  static void _recount(Leaf* const n)
+  {
+    n->count_m = n->size_m;
+    if (!n->leaf_m) {
+      Internal* in = static_cast<Internal*>(n);
+      for (size_type i = 0; i <= n->size_m; ++i) {
+	n->count_m += in->children_m[i]->count_m;
+      }
+    }
+  }
+
+  // Adds delta to the count of n and of each of its ancestors.
+  static void _adjust_counts(Leaf* n, int delta)
+  {
+    for (; n != NULL; n = n->parent_m) {
+      n->count_m += delta;
+    }
+  }
+
+  // Inserts x at slot i of the leaf n (n NULL for an empty map),
+  //   splitting n first if it is full.
+  iterator _insert_leaf(Leaf* n, size_type i, const value_type& x)
+  {
+    if (n == NULL) {
+      n = root_m = _new_leaf();
+    } else if (n->size_m == MAX_KEYS) {
+      _split(n);
+      if (i > MIN_KEYS) {
+	// x goes right of the median, into the new sibling.
+	n = n->parent_m->children_m[n->index_m + 1];
+	i -= MIN_DEGREE;
+      }
+    }
+
+    for (size_type j = n->size_m; j > i; --j) {
+      _relocate(n, j - 1, n, j);
+    }
+    try {
+      _construct(n, i, x);
+    } catch (...) {
+      for (size_type j = i; j < n->size_m; ++j) {
+	_relocate(n, j + 1, n, j);
+      }
+      throw;
+    }
+    ++n->size_m;
+    _adjust_counts(n, 1);
+
+    return iterator(this, n, i);
+  }
+
+  // Splits the full node n around its median, which moves up into the
+  //   parent, splitting the parent first if it is full too.
+  void _split(Leaf* const n)
+  {
+    if (n->parent_m == NULL) {
+      Internal* root = _new_internal();
+      root->count_m = n->count_m;
+      _set_child(root, 0, n);
+      root_m = root;
+    } else if (n->parent_m->size_m == MAX_KEYS) {
+      _split(n->parent_m);
+    }
+
+    Internal* parent = n->parent_m;
+    size_type index = n->index_m;
+    Leaf* sibling = n->leaf_m ? _new_leaf() : _new_internal();
+
+    // the upper half goes to the sibling...
+    for (size_type j = MIN_DEGREE; j < MAX_KEYS; ++j) {
+      _relocate(n, j, sibling, j - MIN_DEGREE);
+    }
+    if (!n->leaf_m) {
+      Internal* in = static_cast<Internal*>(n);
+      for (size_type j = MIN_DEGREE; j <= MAX_KEYS; ++j) {
+	_set_child(static_cast<Internal*>(sibling), j - MIN_DEGREE, in->children_m[j]);
+      }
+    }
+    sibling->size_m = MIN_KEYS;
+
+    // ...and the median into the parent, between n and the sibling.
+    for (size_type j = parent->size_m; j > index; --j) {
+      _relocate(parent, j - 1, parent, j);
+      _set_child(parent, j + 1, parent->children_m[j]);
+    }
+    _relocate(n, MIN_KEYS, parent, index);
+    _set_child(parent, index + 1, sibling);
+    ++parent->size_m;
+    n->size_m = MIN_KEYS;
+
+    _recount(n);
+    _recount(sibling);
+  }
+
+  // Restores the minimum of keys in n, after an erase left it one short,
+  //   by borrowing a key through the parent from a sibling that can
+  //   spare one, or else merging n with a sibling, which takes a key
+  //   from the parent and may leave it short in turn.
+  void _rebalance(Leaf* n)
+  {
+    while (n != root_m && n->size_m < MIN_KEYS) {
+      Internal* parent = n->parent_m;
+      size_type index = n->index_m;
+      Leaf* left = index > 0 ? parent->children_m[index - 1] : NULL;
+      Leaf* right = index < parent->size_m ? parent->children_m[index + 1] : NULL;
+
+      if (left != NULL && left->size_m > MIN_KEYS) {
+	_borrow_left(n, left, parent, index);
+	return;
+      } else if (right != NULL && right->size_m > MIN_KEYS) {
+	_borrow_right(n, right, parent, index);
+	return;
+      } else if (left != NULL) {
+	_merge(left, n, parent, index - 1);
+      } else {
+	_merge(n, right, parent, index);
+      }
+      n = parent;
+    }
+
+    if (root_m != NULL && root_m->size_m == 0) {
+      // the root lost its last key: its only child, if any, takes over.
+      Leaf* old_root = root_m;
+
+      if (old_root->leaf_m) {
+	root_m = NULL;
+      } else {
+	root_m = static_cast<Internal*>(old_root)->children_m[0];
+	root_m->parent_m = NULL;
+	root_m->index_m = 0;
+      }
+      _delete_node(old_root);
+    }
+  }
+
+  // Rotates the last key of left up into parent, and the parent's key
+  //   between them down to the front of n, with left's last child.
+  void _borrow_left(Leaf* const n, Leaf* const left, Internal* const parent, size_type index)
+  {
+    for (size_type j = n->size_m; j > 0; --j) {
+      _relocate(n, j - 1, n, j);
+    }
+    _relocate(parent, index - 1, n, 0);
+    _relocate(left, left->size_m - 1, parent, index - 1);
+
+    size_type moved = 1;
+    if (!n->leaf_m) {
+      Internal* in = static_cast<Internal*>(n);
+      Leaf* child = static_cast<Internal*>(left)->children_m[left->size_m];
+
+      for (size_type j = n->size_m + 1; j > 0; --j) {
+	_set_child(in, j, in->children_m[j - 1]);
+      }
+      _set_child(in, 0, child);
+      moved += child->count_m;
+    }
+
+    ++n->size_m;
+    --left->size_m;
+    n->count_m += moved;
+    left->count_m -= moved;
+  }
+
+  // Rotates the first key of right up into parent, and the parent's key
+  //   between them down to the back of n, with right's first child.
+  void _borrow_right(Leaf* const n, Leaf* const right, Internal* const parent, size_type index)
+  {
+    _relocate(parent, index, n, n->size_m);
+    _relocate(right, 0, parent, index);
+    for (size_type j = 1; j < right->size_m; ++j) {
+      _relocate(right, j, right, j - 1);
+    }
+
+    size_type moved = 1;
+    if (!n->leaf_m) {
+      Internal* in = static_cast<Internal*>(right);
+      Leaf* child = in->children_m[0];
+
+      _set_child(static_cast<Internal*>(n), n->size_m + 1, child);
+      for (size_type j = 0; j < right->size_m; ++j) {
+	_set_child(in, j, in->children_m[j + 1]);
+      }
+      moved += child->count_m;
+    }
+
+    ++n->size_m;
+    --right->size_m;
+    n->count_m += moved;
+    right->count_m -= moved;
+  }
+
+  // Appends the parent's key at index, then all of right, to left, and
+  //   frees right.
+  void _merge(Leaf* const left, Leaf* const right, Internal* const parent, size_type index)
+  {
+    size_type size = left->size_m;
+
+    _relocate(parent, index, left, size);
+    for (size_type j = 0; j < right->size_m; ++j) {
+      _relocate(right, j, left, size + 1 + j);
+    }
+    if (!left->leaf_m) {
+      Internal* in = static_cast<Internal*>(right);
+      for (size_type j = 0; j <= right->size_m; ++j) {
+	_set_child(static_cast<Internal*>(left), size + 1 + j, in->children_m[j]);
+      }
+    }
+    left->size_m += 1 + right->size_m;
+    left->count_m += 1 + right->count_m;
+
+    for (size_type j = index + 1; j < parent->size_m; ++j) {
+      _relocate(parent, j, parent, j - 1);
+      _set_child(parent, j, parent->children_m[j + 1]);
+    }
+    --parent->size_m;
+
+    right->size_m = 0;
+    _delete_node(right);
+  }
+
+  // recursively delete the children, then myself: only as deep as the tree.
+  void _recursive_delete(Leaf* n)
+  {
+    if (n != NULL) {
+      if (!n->leaf_m) {
+	Internal* in = static_cast<Internal*>(n);
+	for (size_type i = 0; i <= n->size_m; ++i) {
+	  _recursive_delete(in->children_m[i]);
+	}
+      }
+      _delete_node(n);
+    }
+  }
+
+  // recursively copy myself, then my children, under parent.
+  Leaf* _clone(Leaf* const n, Internal* const parent, size_type index)
+  {
+    if (n == NULL) {
+      return NULL;
+    }
+
+    Leaf* copy = n->leaf_m ? _new_leaf() : _new_internal();
+    copy->parent_m = parent;
+    copy->index_m = index;
+    copy->count_m = n->count_m;
+    for (; copy->size_m < n->size_m; ++copy->size_m) {
+      _construct(copy, copy->size_m, n->value(copy->size_m));
+    }
+    if (!n->leaf_m) {
+      Internal* in = static_cast<Internal*>(n);
+      for (size_type i = 0; i <= n->size_m; ++i) {
+	static_cast<Internal*>(copy)->children_m[i] = _clone(in->children_m[i], static_cast<Internal*>(copy), i);
+      }
+    }
+    return copy;
+  }
+
+  // Allocates an empty leaf.
+  Leaf* _new_leaf()
+  {
+    Leaf* n = leaf_alloc_m.allocate(1);
+    ::new (static_cast<void*>(n)) Leaf();
+    return n;
+  }
+
+  // Allocates an empty internal node.
+  Internal* _new_internal()
+  {
+    Internal* n = internal_alloc_m.allocate(1);
+    ::new (static_cast<void*>(n)) Internal();
+    return n;
+  }
+
+  // Destroys the elements of a node from _new_leaf() or _new_internal()
+  //   and frees it.
+  void _delete_node(Leaf* n)
+  {
+    for (size_type i = 0; i < n->size_m; ++i) {
+      _destroy(n, i);
+    }
+
+    if (n->leaf_m) {
+      n->~Leaf();
+      leaf_alloc_m.deallocate(n, 1);
+    } else {
+      Internal* in = static_cast<Internal*>(n);
+      in->~Internal();
+      internal_alloc_m.deallocate(in, 1);
+    }
+  }
+};
+
+#endif
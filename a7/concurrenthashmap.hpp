@@ -0,0 +1,224 @@
+#ifndef CONCURRENTHASHMAP_HPP
+#define CONCURRENTHASHMAP_HPP
+
+/**
+ * \file concurrenthashmap.hpp
+ *
+ * Creates a concurrenthashmap: a hashtablemap split into lock-striped
+ * shards, safe to use from several threads at once. Each shard is a
+ * hashtablemap guarded by its own reader-writer lock, picked by the high
+ * bits of the key's hash, so readers never block each other and writers
+ * only block the threads using the same shard.
+ *
+ * Iterators would outlive their lock, so lookups copy the value out
+ * instead of returning one. Needs C++17 (shared_mutex) and -pthread.
+ */
+
+#include <cstddef>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+
+#include "hashtablemap.hpp"
+#include "hashfunction.hpp"
+
+using namespace std;
+
+/**
+ * \class concurrenthashmap
+ * \brief Class concurrenthashmap
+ */
+template <class Key, class T, class Hash = default_hash<Key> >
+class concurrenthashmap
+{
+  typedef concurrenthashmap<Key, T, Hash> Self;
+
+public:
+  typedef Key                key_type;
+  typedef T                  data_type;
+  typedef pair<const Key, T> value_type;
+  typedef unsigned int       size_type;
+  typedef Hash               hasher;
+
+private:
+  typedef hashtablemap<Key, T, Hash> map_type;
+
+  /**
+   * \struct Shard
+   * \brief One lock and the part of the map it guards, on its own cache
+   * lines so that locking one shard does not slow down its neighbours.
+   */
+  struct alignas(64) Shard {
+    mutable shared_mutex lock_m;
+    map_type map_m;
+  };
+
+  // shard_count_m shards, a power of 2.
+  Shard* shards_m;
+  size_type shard_count_m;
+
+  // hash function object, also used to pick shards.
+  Hash hash_m;
+
+  size_type static const DEFAULT_SHARD_COUNT = 16;
+
+public:
+  ///\brief Constructor to create an empty map with at least n shards.
+  explicit concurrenthashmap(size_type n = DEFAULT_SHARD_COUNT)
+    : shards_m(NULL), shard_count_m(1)
+  {
+    while (shard_count_m < n) {
+      shard_count_m *= 2;
+    }
+    shards_m = new Shard[shard_count_m];
+  }
+
+  /**
+   * \brief Destructor; no other thread may use the map any more.
+   */
+  ~concurrenthashmap()
+  {
+    delete [] shards_m;
+  }
+
+  /**
+   * \brief Copies the value of key k into value.
+   * \return True iff k was found.
+   */
+  template <class K>
+  bool find(const K& k, T& value) const
+  {
+    const Shard& shard = _shard(k);
+    shared_lock<shared_mutex> guard(shard.lock_m);
+
+    typename map_type::const_iterator it = shard.map_m.find(k);
+    if (it == shard.map_m.end()) {
+      return false;
+    }
+
+    value = it->second;
+    return true;
+  }
+
+  /**
+   * \brief Counts the number of times an element is found in the map.
+   */
+  template <class K>
+  size_type count(const K& k) const
+  {
+    const Shard& shard = _shard(k);
+    shared_lock<shared_mutex> guard(shard.lock_m);
+    return shard.map_m.count(k);
+  }
+
+  /**
+   * \brief Inserts an element by a given pair, unless its key is already
+   * in the map.
+   * \return True iff x was inserted.
+   */
+  bool insert(const value_type& x)
+  {
+    Shard& shard = _shard(x.first);
+    unique_lock<shared_mutex> guard(shard.lock_m);
+    return shard.map_m.insert(x).second;
+  }
+
+  /**
+   * \brief Inserts an element with key k and value obj, or assigns obj
+   * to the value of k if it is already in the map.
+   * \return True iff a new element was inserted.
+   */
+  template <class M>
+  bool insert_or_assign(const Key& k, M&& obj)
+  {
+    Shard& shard = _shard(k);
+    unique_lock<shared_mutex> guard(shard.lock_m);
+    return shard.map_m.insert_or_assign(k, std::forward<M>(obj)).second;
+  }
+
+  /**
+   * \brief Erases by a given key value.
+   * \return size_type number of elements erased
+   */
+  size_type erase(const Key& k)
+  {
+    Shard& shard = _shard(k);
+    unique_lock<shared_mutex> guard(shard.lock_m);
+    return shard.map_m.erase(k);
+  }
+
+  /**
+   * \brief Returns the number of elements, locking one shard at a time:
+   * exact only if no other thread is writing.
+   */
+  size_type size() const
+  {
+    size_type total = 0;
+    for (size_type i = 0; i < shard_count_m; ++i) {
+      shared_lock<shared_mutex> guard(shards_m[i].lock_m);
+      total += shards_m[i].map_m.size();
+    }
+    return total;
+  }
+
+  /**
+   * \brief Checks if map has no inserted elements, see size().
+   */
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+  /**
+   * \brief Erases every element, one shard at a time.
+   */
+  void clear()
+  {
+    for (size_type i = 0; i < shard_count_m; ++i) {
+      unique_lock<shared_mutex> guard(shards_m[i].lock_m);
+      shards_m[i].map_m.clear();
+    }
+  }
+
+  /**
+   * \brief Calls f(key, value) on every element, holding each shard's
+   * lock for reading while visiting it. f must not use this map.
+   */
+  template <class F>
+  void for_each(F f) const
+  {
+    for (size_type i = 0; i < shard_count_m; ++i) {
+      shared_lock<shared_mutex> guard(shards_m[i].lock_m);
+      const map_type& map = shards_m[i].map_m;
+      for (typename map_type::const_iterator it = map.begin(); it != map.end(); ++it) {
+	f(it->first, it->second);
+      }
+    }
+  }
+
+  /**
+   * \brief Returns the number of shards.
+   */
+  size_type shard_count() const
+  {
+    return shard_count_m;
+  }
+
+private:
+  // the shards hold locks, which cannot be copied.
+  concurrenthashmap(const Self&);
+  Self& operator=(const Self&);
+
+  /**
+   * \brief Picks the shard of a key from the high bits of its hash; the
+   * shard's map uses the hash modulo its bucket count, i.e. the low bits.
+   */
+  template <class K>
+  Shard& _shard(const K& k) const
+  {
+    size_t hashvalue = hash_m(k);
+    return shards_m[(hashvalue >> (sizeof(size_t) * 8 - 16)) & (shard_count_m - 1)];
+  }
+};
+
+#endif // CONCURRENTHASHMAP_HPP
@@ -11,6 +11,7 @@
 
 #include "Cell.hpp"
 #include <string>
+#include <cstring>
 #include <iostream>
 #include "helper.hpp"
 #include <vector>
@@ -58,6 +59,33 @@ inline Cell* cons(Cell* const my_car, Cell* const my_cdr)
   return (Cell*) new ConsCell(my_car, my_cdr);
 }
 
+/**
+ * \brief Make an immutable list stored contiguously as a CDR-coded block.
+ * \param elems The elements of the list, in order.
+ * \return The list, nil if elems is empty.
+ */
+inline Cell* make_list(const vector<Cell*>& elems)
+{
+  if (elems.empty()) {
+    return nil;
+  }
+  return CompactConsCell::make_block(elems);
+}
+
+/**
+ * \brief Make an immutable list stored contiguously as a CDR-coded block.
+ * \param elems The elements of the list, in order.
+ * \param length The number of elements.
+ * \return The list, nil if length is 0.
+ */
+inline Cell* make_list(Cell* const* elems, const size_t length)
+{
+  if (length == 0) {
+    return nil;
+  }
+  return CompactConsCell::make_block(elems, length);
+}
+
 /**
  * \brief Make a procedure cell.
  * \param my_formals A list of the procedure's formal parameter names.
@@ -68,6 +96,15 @@ inline Cell* lambda(Cell* const my_formals, Cell* const my_body)
   return new ProcedureCell(my_formals, my_body);
 }
 
+/**
+ * \brief Make an ordered map cell.
+ * \param entries The entries of the map, taken over.
+ */
+inline Cell* make_map(MapCell::ordered_map&& entries)
+{
+  return new MapCell(std::move(entries));
+}
+
 /**
  * \brief Make an operator cell.
  * \param s The initial operator name to be stored in the new cell.
@@ -86,6 +123,15 @@ inline bool nullp(Cell* const c)
   return (c == nil);
 }
 
+/**
+ * \brief Check if c points to a cons cell.
+ * \return True iff c points to a cons cell.
+ */
+inline bool consp(Cell* const c)
+{
+  return !nullp(c) && c->is_cons();
+}
+
 /**
  * \brief Check if c points to a list (i.e., nil or a cons cell).
  * \return True iff c points to a list (i.e., nil or a cons cell).
@@ -104,6 +150,15 @@ inline bool procedurep(Cell* const c)
   return !nullp(c) && c->is_procedure();
 }
 
+/**
+ * \brief Check if c is an ordered map cell.
+ * \return True iff c is an ordered map cell.
+ */
+inline bool mapp(Cell* const c)
+{
+  return !nullp(c) && c->is_map();
+}
+
 /**
  * \brief Check if c points to an int cell.
  * \return True iff c points to an int cell.
@@ -146,6 +201,13 @@ inline bool operatorp(Cell* const c)
  */
 inline bool nonzerop(Cell* const c)
 {
+  if (intp(c)) {
+    // Tag already checked, skip the virtual dispatch.
+    return static_cast<IntCell*>(c)->IntCell::get_int() != 0;
+  } else if (doublep(c)) {
+    return static_cast<DoubleCell*>(c)->DoubleCell::get_double() != 0;
+  }
+
   try {
     assert_cellnotnull("Given c was null", c);
   } catch (runtime_error& e) {
@@ -161,6 +223,11 @@ inline bool nonzerop(Cell* const c)
  */
 inline int get_int(Cell* const c)
 {
+  if (intp(c)) {
+    // Tag already checked, skip the virtual dispatch.
+    return static_cast<IntCell*>(c)->IntCell::get_int();
+  }
+
   try {
     assert_cellnotnull("Given c was null", c);
   } catch (runtime_error& e) {
@@ -176,6 +243,11 @@ inline int get_int(Cell* const c)
  */
 inline double get_double(Cell* const c)
 {
+  if (doublep(c)) {
+    // Tag already checked, skip the virtual dispatch.
+    return static_cast<DoubleCell*>(c)->DoubleCell::get_double();
+  }
+
   try {
     assert_cellnotnull("Given c was null", c);
   } catch (runtime_error& e) {
@@ -192,6 +264,10 @@ inline double get_double(Cell* const c)
  */
 inline string get_symbol(Cell* const c)
 {
+  if (symbolp(c) || operatorp(c)) {
+    // Tag already checked, skip the virtual dispatch.
+    return static_cast<SymbolCell*>(c)->SymbolCell::get_symbol();
+  }
 
   try {
     assert_cellnotnull("Given c was null", c);
@@ -208,6 +284,14 @@ inline string get_symbol(Cell* const c)
  */
 inline Cell* car(Cell* const c)
 {
+  if (consp(c)) {
+    // Tag already checked, skip the virtual dispatch.
+    if (c->get_cdr_code() != cdr_normal) {
+      return static_cast<CompactConsCell*>(c)->CompactConsCell::get_car();
+    }
+    return static_cast<ConsCell*>(c)->ConsCell::get_car();
+  }
+
   try {
     assert_cellnotnull("Given c was null", c);
   } catch (runtime_error& e) {
@@ -223,6 +307,14 @@ inline Cell* car(Cell* const c)
  */
 inline Cell* cdr(Cell* const c)
 {
+  if (consp(c)) {
+    // Tag already checked, skip the virtual dispatch.
+    if (c->get_cdr_code() != cdr_normal) {
+      return static_cast<CompactConsCell*>(c)->CompactConsCell::get_cdr();
+    }
+    return static_cast<ConsCell*>(c)->ConsCell::get_cdr();
+  }
+
   try {
     assert_cellnotnull("Given c was null", c);
   } catch (runtime_error& e) {
@@ -238,6 +330,13 @@ inline Cell* cdr(Cell* const c)
  */
 inline double get_value(Cell* const c)
 {
+  if (intp(c)) {
+    // Tag already checked, skip the virtual dispatch.
+    return static_cast<IntCell*>(c)->IntCell::get_value();
+  } else if (doublep(c)) {
+    return static_cast<DoubleCell*>(c)->DoubleCell::get_value();
+  }
+
   try {
     assert_cellnotnull("Given c was null", c);
   } catch (runtime_error& e) {
@@ -248,65 +347,84 @@ inline double get_value(Cell* const c)
 }
 
 /**
- * \brief Gets the operation type from a string
- * \param opr string Operator name
+ * \brief Gets the operation type from a C string, e.g. a symbol name,
+ * without building a string.
+ * \param opr Operator name
  * \return Operation enum value. 
  */
-inline Operation get_operation(string const opr)
+inline Operation get_operation(const char* const opr)
 {
-  if (opr == "+") {
+  if (strcmp(opr, "+") == 0) {
     return add_opr;
-  } else if (opr == "if") {
+  } else if (strcmp(opr, "if") == 0) {
     return if_opr;
-  } else if (opr == "ceiling") {
+  } else if (strcmp(opr, "ceiling") == 0) {
     return ceil_opr;
-  } else if (opr == "-") {
+  } else if (strcmp(opr, "-") == 0) {
     return minus_opr;
-  } else if (opr == "*") {
+  } else if (strcmp(opr, "*") == 0) {
     return multiply_opr;
-  } else if (opr == "/") {
+  } else if (strcmp(opr, "/") == 0) {
     return divide_opr;
-  } else if (opr == "floor") {
+  } else if (strcmp(opr, "floor") == 0) {
     return floor_opr;
-  } else if (opr == "quote") {
+  } else if (strcmp(opr, "quote") == 0) {
     return quote_opr;
-  } else if (opr == "cons") {
+  } else if (strcmp(opr, "cons") == 0) {
     return cons_opr;
-  } else if (opr == "car") {
+  } else if (strcmp(opr, "car") == 0) {
     return car_opr;
-  } else if (opr == "cdr") {
+  } else if (strcmp(opr, "cdr") == 0) {
     return cdr_opr;
-  } else if (opr == "nullp") {
+  } else if (strcmp(opr, "nullp") == 0) {
     return nullp_opr;
-  } else if (opr == "define") {
+  } else if (strcmp(opr, "define") == 0) {
     return define_opr;
-  } else if (opr == "<") {
+  } else if (strcmp(opr, "<") == 0) {
     return lessthan_opr;
-  } else if (opr == "not") {
+  } else if (strcmp(opr, "not") == 0) {
     return not_opr;
-  } else if (opr == "print") {
+  } else if (strcmp(opr, "print") == 0) {
     return print_opr;
-  } else if (opr == "eval") {
+  } else if (strcmp(opr, "eval") == 0) {
     return eval_opr;
-  } else if (opr == "lambda") {
+  } else if (strcmp(opr, "lambda") == 0) {
     return lambda_opr;
-  } else if (opr == "apply") {
+  } else if (strcmp(opr, "apply") == 0) {
     return apply_opr;
-  } else if (opr == "let") {
+  } else if (strcmp(opr, "let") == 0) {
     return let_opr;
-  } else if (opr == "intp") {
+  } else if (strcmp(opr, "intp") == 0) {
     return intp_opr;
-  } else if (opr == "doublep") {
+  } else if (strcmp(opr, "doublep") == 0) {
     return doublep_opr;
-  } else if (opr == "symbolp") {
+  } else if (strcmp(opr, "symbolp") == 0) {
     return symbolp_opr;
-  } else if (opr == "listp") {
+  } else if (strcmp(opr, "listp") == 0) {
     return listp_opr;
+  } else if (strcmp(opr, "eq?") == 0) {
+    return eqp_opr;
+  } else if (strcmp(opr, "heap-stats") == 0) {
+    return heapstats_opr;
+  } else if (strcmp(opr, "ordered-map") == 0) {
+    return orderedmap_opr;
+  } else if (strcmp(opr, "ordered-map-range") == 0) {
+    return orderedmaprange_opr;
   } else {
     return undefined_opr;
   }
 }
 
+/**
+ * \brief Gets the operation type from a string
+ * \param opr string Operator name
+ * \return Operation enum value. 
+ */
+inline Operation get_operation(string const& opr)
+{
+  return get_operation(opr.c_str());
+}
+
 /**
  * \brief Accessor (error if c is not a procedure cell).
  * \return Pointer to the cons list of formal parameters for the function
@@ -314,6 +432,11 @@ inline Operation get_operation(string const opr)
  */
 inline Cell* get_formals(Cell* const c)
 {
+  if (procedurep(c)) {
+    // Tag already checked, skip the virtual dispatch.
+    return static_cast<ProcedureCell*>(c)->ProcedureCell::get_formals();
+  }
+
   try {
     assert_cellnotnull("Given c was null", c);
   } catch (runtime_error& e) {
@@ -329,6 +452,11 @@ inline Cell* get_formals(Cell* const c)
  */
 inline Cell* get_body(Cell* const c)
 {
+  if (procedurep(c)) {
+    // Tag already checked, skip the virtual dispatch.
+    return static_cast<ProcedureCell*>(c)->ProcedureCell::get_body();
+  }
+
   try {
     assert_cellnotnull("Given c was null", c);
   } catch (runtime_error& e) {
@@ -359,6 +487,11 @@ inline int list_size(Cell* const c)
   Cell* curr = c;
 
   while(!nullp(curr)) {
+    if (consp(curr) && curr->get_cdr_code() != cdr_normal) {
+      // A CDR-coded block knows the length of the rest of the list.
+      return size + static_cast<CompactConsCell*>(curr)->get_length();
+    }
+
     ++size;
     if (!listp(curr)) {
       return size;
@@ -8,8 +8,6 @@
 
 using namespace std;
 
-typedef hashtablemap<string, Cell*> hashmap;
-
 // Initialize stack_frame with one map frame.
 vector< hashmap > stack_frame(1, hashmap());
 
@@ -245,7 +243,8 @@ Cell* quote_eval(Cell* const c)
       return nil;
     }
 
-    return clone_cell(my_car);
+    // Quoted data is immutable, so it is shared rather than copied.
+    return my_car;
   } catch (runtime_error& e) {
     throw_error(e.what(), trace_prefix);
   }
@@ -367,11 +366,7 @@ Cell* define_eval(Cell* const c)
     //   if pair.second is false, it means there has been an element defined on that key. 
 
     pair<hashmap::iterator, bool> itbool_pair;
-    hashmap defined_frame = stack_frame.back();
-    stack_frame.pop_back();
-
-    itbool_pair = defined_frame.insert(pair<string, Cell*>(key, value));
-    stack_frame.push_back(defined_frame);
+    itbool_pair = stack_frame.back().insert(pair<string, Cell*>(key, value));
 
     if (itbool_pair.second == false) {
       throw_error("Cannot redefine a mapped definition \"" + key + "\"");
@@ -446,16 +441,10 @@ Cell* not_eval(Cell* const c)
  
     value = cell_eval(value);
 
-    // try/catch block to catch for non-int/double types.
-    //   returns assumed 0 for non-value types.
-    try {
-      if (get_value(value) == 0) {
-	return make_int(1);
-      } else {
-	return make_int(0);
-      }
-    } catch (runtime_error&) {
-      // error'd at get_value.
+    // returns assumed 0 for non-value types.
+    if ((intp(value) || doublep(value)) && get_value(value) == 0) {
+      return make_int(1);
+    } else {
       return make_int(0);
     }
   } catch (runtime_error& e) {
@@ -666,3 +655,119 @@ Cell* listp_eval(Cell* const c)
     throw_error(e.what(), trace_prefix);
   }
 }
+
+Cell* eqp_eval(Cell* const c)
+{
+  string trace_prefix = "eval.cpp::eqp_eval(Cell*)";
+
+  Cell *value, *next_value;
+  value = next_value = nil;
+  try {
+    assert_listsize("Expected only two operands", c, 2);
+
+    value = cell_eval(car(c));
+    next_value = cell_eval(car(cdr(c)));
+
+    // Values are shared, so the same cell means the same value.
+    if (value == next_value) {
+      return make_int(1);
+    } else {
+      return make_int(0);
+    }
+  } catch (runtime_error& e) {
+    throw_error(e.what(), trace_prefix);
+  }
+  return nil;
+}
+
+Cell* heapstats_eval(Cell* const c)
+{
+  string trace_prefix = "eval.cpp::heapstats_eval(Cell*)";
+
+  try {
+    assert_listsize("Expected no operands", c, 0);
+
+    heap_report(cout);
+    return nil;
+  } catch (runtime_error& e) {
+    throw_error(e.what(), trace_prefix);
+  }
+  return nil;
+}
+
+Cell* orderedmap_eval(Cell* const c)
+{
+  string trace_prefix = "eval.cpp::orderedmap_eval(Cell*)";
+
+  Cell *alist, *entry, *key, *value;
+  alist = entry = key = value = nil;
+  try {
+    assert_listsize("Expected only one operand", c, 1);
+
+    alist = cell_eval(car(c));
+    if (!listp(alist)) {
+      throw_error("Expected an association list");
+    }
+
+    MapCell::ordered_map entries;
+    for (Cell* curr = alist; !nullp(curr); curr = cdr(curr)) {
+      entry = car(curr);
+      // Only (key value) lists: a dotted pair (key . value) would be
+      //   ambiguous with a list value.
+      if (!consp(entry) || !consp(cdr(entry))) {
+	throw_error("Expected (key value) entries");
+      }
+      assert_listsize("Expected (key value) entries", entry, 2);
+
+      key = car(entry);
+      assert_isdoubleintcell("Keys must be ints or doubles", key);
+      value = car(cdr(entry));
+
+      entries.insert(MapCell::ordered_map::value_type(get_value(key),
+						       pair<Cell*, Cell*>(key, value)));
+    }
+
+    return make_map(std::move(entries));
+  } catch (runtime_error& e) {
+    throw_error(e.what(), trace_prefix);
+  }
+  return nil;
+}
+
+Cell* orderedmaprange_eval(Cell* const c)
+{
+  string trace_prefix = "eval.cpp::orderedmaprange_eval(Cell*)";
+
+  Cell *map, *lo, *hi;
+  map = lo = hi = nil;
+  try {
+    assert_listsize("Expected three operands", c, 3);
+
+    map = cell_eval(car(c));
+    lo = cell_eval(car(cdr(c)));
+    hi = cell_eval(car(cdr(cdr(c))));
+
+    if (!mapp(map)) {
+      throw_error("Expected an ordered map");
+    }
+    assert_isdoubleintcell("Bounds must be ints or doubles", lo);
+    assert_isdoubleintcell("Bounds must be ints or doubles", hi);
+
+    const MapCell::ordered_map& entries = static_cast<MapCell*>(map)->get_map();
+    pair<MapCell::ordered_map::const_iterator, MapCell::ordered_map::const_iterator>
+      bounds = entries.range(get_value(lo), get_value(hi));
+
+    vector<Cell*> result;
+    vector<Cell*> key_value(2);
+    for (MapCell::ordered_map::const_iterator it = bounds.first; it != bounds.second; ++it) {
+      key_value[0] = it->second.first;
+      key_value[1] = it->second.second;
+      result.push_back(make_list(key_value));
+    }
+
+    return make_list(result);
+  } catch (runtime_error& e) {
+    throw_error(e.what(), trace_prefix);
+  }
+  return nil;
+}
@@ -17,8 +17,6 @@
 
 using namespace std;
 
-typedef hashtablemap<string, Cell*> hashmap;
-
 /**
  * \brief The global stack frame vector container holding defined maps.
  */
@@ -243,5 +241,45 @@ Cell* symbolp_eval(Cell* const c);
  */
 Cell* listp_eval(Cell* const c);
 
+/**
+ * \brief Evaluate the sub-expression tree whose root is pointed to by c
+ * (error if c does not hold a well-formed expression).
+ * Compares the identity of the two operands' values, which for hash-consed
+ * data is structural equality.
+ *
+ * \return The value resulting from evaluating the sub-expression.
+ */
+Cell* eqp_eval(Cell* const c);
+
+/**
+ * \brief Evaluate the sub-expression tree whose root is pointed to by c
+ * (error if c does not hold a well-formed expression).
+ * Prints the live and allocated cells and bytes of each cell type.
+ *
+ * \return The value resulting from evaluating the sub-expression.
+ */
+Cell* heapstats_eval(Cell* const c);
+
+/**
+ * \brief Evaluate the sub-expression tree whose root is pointed to by c
+ * (error if c does not hold a well-formed expression).
+ * Builds an ordered map from an association list of (key value) entries
+ * with numeric keys; the first entry of a key wins. Dotted (key . value)
+ * pairs are rejected, as a list value would be ambiguous.
+ *
+ * \return The value resulting from evaluating the sub-expression.
+ */
+Cell* orderedmap_eval(Cell* const c);
+
+/**
+ * \brief Evaluate the sub-expression tree whose root is pointed to by c
+ * (error if c does not hold a well-formed expression).
+ * Lists the (key value) entries of an ordered map with lo <= key <= hi,
+ * in key order, in O(log n) plus the number of entries listed.
+ *
+ * \return The value resulting from evaluating the sub-expression.
+ */
+Cell* orderedmaprange_eval(Cell* const c);
+
 
 #endif // EVAL_HPP
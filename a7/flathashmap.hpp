@@ -0,0 +1,929 @@
+#ifndef FLATHASHMAP_HPP
+#define FLATHASHMAP_HPP
+
+/**
+ * \file flathashmap.hpp
+ *
+ * Creates a flathashmap: an open-addressing hash map with the same
+ * interface as hashtablemap, storing its elements inline in one slot
+ * array (SwissTable layout).
+ *
+ * Every slot has a control byte: EMPTY, DELETED, or, for a full slot,
+ * the low 7 bits of the hash of its key (h2). A lookup starts at a slot
+ * chosen by the remaining bits of the hash (h1) and compares the h2 of
+ * 16 consecutive control bytes at once, with SSE2 when available, so it
+ * only compares keys of likely matches and stops at the first group
+ * holding an EMPTY slot.
+ */
+
+#include <utility>
+#include <stdexcept>
+#include <iostream>
+#include <iterator>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <tuple>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "hashfunction.hpp"
+
+using namespace std;
+
+/**
+ * \class flathashmap
+ * \brief Class flathashmap
+ */
+template <class Key, class T, class Hash = default_hash<Key> >
+class flathashmap
+{
+  typedef flathashmap<Key, T, Hash> Self;
+
+public:
+  typedef Key                key_type;
+  typedef T                  data_type;
+  typedef pair<const Key, T> value_type;
+  typedef unsigned int       size_type;
+  typedef int                difference_type;
+  typedef Hash               hasher;
+
+private:
+  typedef signed char ctrl_type;
+
+  // control byte of a slot that was never used, stops lookups.
+  static const ctrl_type EMPTY = -128;
+
+  // control byte of an erased slot, lookups probe past it.
+  static const ctrl_type DELETED = -2;
+
+  // number of control bytes compared at once.
+  static const size_type GROUP_WIDTH = 16;
+
+  /**
+   * \struct Group
+   * \brief GROUP_WIDTH control bytes loaded at once, answering which of
+   * them match as a bit mask (bit i for byte i).
+   */
+  struct Group {
+#ifdef __SSE2__
+    explicit Group(const ctrl_type* pos)
+      : ctrl_m(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+    unsigned int match(ctrl_type h2) const
+    {
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_m));
+    }
+
+    unsigned int match_empty() const
+    {
+      return match(EMPTY);
+    }
+
+    // EMPTY and DELETED are the only negative control bytes.
+    unsigned int match_empty_or_deleted() const
+    {
+      return _mm_movemask_epi8(ctrl_m);
+    }
+
+    __m128i ctrl_m;
+#else
+    explicit Group(const ctrl_type* pos)
+    {
+      memcpy(ctrl_m, pos, GROUP_WIDTH);
+    }
+
+    unsigned int match(ctrl_type h2) const
+    {
+      unsigned int mask = 0;
+      for (size_type i = 0; i < GROUP_WIDTH; ++i) {
+	if (ctrl_m[i] == h2) {
+	  mask |= 1u << i;
+	}
+      }
+      return mask;
+    }
+
+    unsigned int match_empty() const
+    {
+      return match(EMPTY);
+    }
+
+    unsigned int match_empty_or_deleted() const
+    {
+      unsigned int mask = 0;
+      for (size_type i = 0; i < GROUP_WIDTH; ++i) {
+	if (ctrl_m[i] < 0) {
+	  mask |= 1u << i;
+	}
+      }
+      return mask;
+    }
+
+    ctrl_type ctrl_m[GROUP_WIDTH];
+#endif
+  };
+
+  // Control bytes: capacity_m of them, then a copy of the first
+  //  GROUP_WIDTH so a group read near the end wraps around.
+  ctrl_type* ctrl_m;
+
+  // Uninitialized storage for capacity_m elements.
+  value_type* slots_m;
+
+  // number of slots, a power of 2 (0 before the first insert).
+  size_type capacity_m;
+
+  // holds the number of values/elements in map
+  size_type size_m;
+
+  // number of DELETED slots, which count against the load factor.
+  size_type deleted_m;
+
+  // the table grows when (size_m + deleted_m) / capacity_m would exceed this.
+  float max_load_factor_m;
+
+  // hash function object.
+  Hash hash_m;
+
+public:
+  ////////////////////////////////////////////////////////////////////////////////
+  // template class iterator
+
+  template<typename _T>
+  class _iterator
+  {
+  public:
+    typedef forward_iterator_tag iterator_category;
+    typedef _T value_type;
+    typedef int difference_type;
+    typedef value_type* pointer;
+    typedef value_type& reference;
+
+    friend class flathashmap;
+    template<typename _U> friend class _iterator;
+  private:
+    // pointer to a table instance.
+    const flathashmap* table_m;
+
+    // index of a full slot, capacity_m for end().
+    size_type index_m;
+
+  public:
+    _iterator(const flathashmap* my_table = NULL, size_type my_index = 0)
+      : table_m(my_table), index_m(my_index) {}
+
+    // iterator converts to const_iterator.
+    template<typename _U>
+    _iterator(const _iterator<_U>& x)
+      : table_m(x.table_m), index_m(x.index_m) {}
+
+    reference operator*() const
+    {
+      return table_m->slots_m[index_m];
+    }
+
+    pointer operator->() const
+    {
+      return &(table_m->slots_m[index_m]);
+    }
+
+    // Steps to the next full slot.
+    _iterator& operator++()
+    {
+      index_m = table_m->_next_full(index_m + 1);
+      return (*this);
+    }
+
+    _iterator operator++(int)
+    {
+      _iterator temp = *this;
+      ++(*this);
+      return temp;
+    }
+
+    friend bool operator==(const _iterator& x, const _iterator& y)
+    {
+      return (x.index_m == y.index_m);
+    }
+
+    friend bool operator!=(const _iterator& x, const _iterator& y)
+    {
+      return (x.index_m != y.index_m);
+    }
+  };
+
+  // template class _iterator
+  ////////////////////////////////////////////////////////////////////////////////
+
+  typedef _iterator<value_type> iterator;
+  typedef _iterator<const value_type> const_iterator;
+
+public:
+  ///\brief Default constructor to create an empty map, allocating nothing.
+  flathashmap()
+    : ctrl_m(NULL), slots_m(NULL), capacity_m(0), size_m(0), deleted_m(0),
+      max_load_factor_m(0.875f) {}
+
+  ///\brief Constructor to create an empty map with room for n elements.
+  explicit flathashmap(size_type n)
+    : ctrl_m(NULL), slots_m(NULL), capacity_m(0), size_m(0), deleted_m(0),
+      max_load_factor_m(0.875f)
+  {
+    reserve(n);
+  }
+
+  ///\brief Copy constructor with deep copying.
+  flathashmap(const Self& x)
+    : ctrl_m(NULL), slots_m(NULL), capacity_m(0), size_m(0), deleted_m(0),
+      max_load_factor_m(x.max_load_factor_m), hash_m(x.hash_m)
+  {
+    _copy_from(x);
+  }
+
+  ///\brief Move constructor: takes x's slots in O(1), leaving x empty.
+  flathashmap(Self&& x) noexcept
+    : ctrl_m(x.ctrl_m), slots_m(x.slots_m), capacity_m(x.capacity_m),
+      size_m(x.size_m), deleted_m(x.deleted_m),
+      max_load_factor_m(x.max_load_factor_m), hash_m(x.hash_m)
+  {
+    x.ctrl_m = NULL;
+    x.slots_m = NULL;
+    x.capacity_m = x.size_m = x.deleted_m = 0;
+  }
+
+  /**
+   * \brief Destructor
+   */
+  ~flathashmap()
+  {
+    _destroy();
+  }
+
+  ///\brief Assignment operator with deep copying.
+  Self& operator=(const Self& x)
+  {
+    /// guard against self assignment
+    if (this == &x) {
+      return *this;
+    }
+
+    _destroy();
+    max_load_factor_m = x.max_load_factor_m;
+    hash_m = x.hash_m;
+    _copy_from(x);
+    return *this;
+  }
+
+  ///\brief Move assignment: takes x's slots in O(1), leaving x empty.
+  Self& operator=(Self&& x) noexcept
+  {
+    if (this != &x) {
+      _destroy();
+      Self temp(static_cast<Self&&>(x));
+      swap(temp);
+    }
+    return *this;
+  }
+
+  /**
+   * \brief Exchanges the contents of two maps in O(1).
+   */
+  void swap(Self& x) noexcept
+  {
+    _swap_member(ctrl_m, x.ctrl_m);
+    _swap_member(slots_m, x.slots_m);
+    _swap_member(capacity_m, x.capacity_m);
+    _swap_member(size_m, x.size_m);
+    _swap_member(deleted_m, x.deleted_m);
+    _swap_member(max_load_factor_m, x.max_load_factor_m);
+    _swap_member(hash_m, x.hash_m);
+  }
+
+  /**
+   * \brief Returns an iterator to the first element.
+   */
+  iterator begin()
+  {
+    return iterator(this, _next_full(0));
+  }
+
+  /**
+   * \brief Returns a const iterator to the first element.
+   */
+  const_iterator begin() const
+  {
+    return const_iterator(this, _next_full(0));
+  }
+
+  /**
+   * \brief Returns an iterator one past the last slot.
+   */
+  iterator end()
+  {
+    return iterator(this, capacity_m);
+  }
+
+  /**
+   * \brief Returns a const iterator one past the last slot.
+   */
+  const_iterator end() const
+  {
+    return const_iterator(this, capacity_m);
+  }
+
+  /**
+   * \brief Checks if map has no inserted elements.
+   */
+  bool empty() const
+  {
+    return (size_m == 0);
+  }
+
+  /**
+   * \brief Returns the number of elements inserted.
+   */
+  size_type size() const
+  {
+    return size_m;
+  }
+
+  /**
+   * \brief Inserts an element by a given pair
+   * \return An iterator to the element with the key of x, and true iff
+   *   it was inserted.
+   */
+  pair<iterator,bool> insert(const value_type& x)
+  {
+    return _try_emplace(x.first, x);
+  }
+
+  /**
+   * \brief Inserts an element constructed from args, unless its key is
+   * already in the map.
+   * \return An iterator to the element with that key, and true iff the
+   *   new element was inserted.
+   */
+  template <class... Args>
+  pair<iterator,bool> emplace(Args&&... args)
+  {
+    // The key is only known once the element is built.
+    value_type value(std::forward<Args>(args)...);
+    return _try_emplace(value.first, static_cast<value_type&&>(value));
+  }
+
+  /**
+   * \brief Inserts an element with key k and a value constructed from
+   * args, unless k is already in the map; then args are left untouched.
+   * \return An iterator to the element with key k, and true iff the
+   *   new element was inserted.
+   */
+  template <class... Args>
+  pair<iterator,bool> try_emplace(const Key& k, Args&&... args)
+  {
+    return _try_emplace(k, piecewise_construct, forward_as_tuple(k),
+			forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  /**
+   * \brief Inserts an element with key k and value obj, or assigns obj
+   * to the value of k if it is already in the map.
+   * \return An iterator to the element with key k, and true iff the
+   *   new element was inserted.
+   */
+  template <class M>
+  pair<iterator,bool> insert_or_assign(const Key& k, M&& obj)
+  {
+    size_t hashvalue = _hash(k);
+    pair<size_type, bool> probe_pair = _probe(k, hashvalue);
+
+    if (probe_pair.second) {
+      slots_m[probe_pair.first].second = std::forward<M>(obj);
+      return pair<iterator, bool>(iterator(this, probe_pair.first), false);
+    }
+
+    size_type index = _claim(probe_pair.first, hashvalue);
+    ::new (slots_m + index) value_type(k, std::forward<M>(obj));
+    _occupy(index, hashvalue);
+
+    return pair<iterator, bool>(iterator(this, index), true);
+  }
+
+  /**
+   * \brief Erases from an iterator
+   */
+  void erase(iterator pos)
+  {
+    if (pos == end()) {
+      throw runtime_error("Cannot erase end iterator");
+    }
+
+    _erase_index(pos.index_m);
+  }
+
+  /**
+   * \brief Erases by a given key value.
+   * \return size_type number of elements erased
+   */
+  size_type erase(const Key& x)
+  {
+    size_type index = _find_index(x, _hash(x));
+
+    if (index == capacity_m) {
+      return 0;
+    }
+
+    _erase_index(index);
+    return 1; // since Key in maps are unique, can only be 1
+  }
+
+  /**
+   * \brief Empty the map, keeping its slots.
+   */
+  void clear()
+  {
+    for (size_type i = 0; i < capacity_m; ++i) {
+      if (ctrl_m[i] >= 0) {
+	slots_m[i].~value_type();
+      }
+    }
+    if (capacity_m > 0) {
+      memset(ctrl_m, EMPTY, capacity_m + GROUP_WIDTH);
+    }
+    size_m = 0;
+    deleted_m = 0;
+  }
+
+  /**
+   * \brief Finds the element with given key.
+   * \return An iterator pointing to the element found.
+   *   returns end() if not found.
+   */
+  iterator find(const Key& x)
+  {
+    return iterator(this, _find_index(x, _hash(x)));
+  }
+
+  /**
+   * \brief Finds the element with given key.
+   * \return A const iterator pointing to the element found.
+   *    returns end() if not found.
+   */
+  const_iterator find(const Key& x) const
+  {
+    return const_iterator(this, _find_index(x, _hash(x)));
+  }
+
+  /**
+   * \brief Counts the number of times an element is found in the map.
+   */
+  size_type count(const Key& x) const
+  {
+    return (_find_index(x, _hash(x)) != capacity_m) ? 1 : 0;
+  }
+
+  /**
+   * \brief Subscript operator accessor.
+   */
+  T& operator[](const Key& k)
+  {
+    // Hashes and probes once, whether k is found or inserted.
+    return try_emplace(k).first->second;
+  }
+
+  /**
+   * \brief Alternative to the subscript operator,
+   * but throws out_of_range exception when element is not found.
+   */
+  T& at(const Key& k)
+  {
+    size_type index = _find_index(k, _hash(k));
+
+    if (index == capacity_m) {
+      throw out_of_range("K is not found");
+    }
+
+    return slots_m[index].second;
+  }
+
+  /**
+   * \brief Finds the element with a key comparable to Key without
+   * converting it, e.g. a const char* or string_view for string keys.
+   * Hash must hash equal K and Key values equally.
+   */
+  template <class K>
+  iterator find(const K& x)
+  {
+    return iterator(this, _find_index(x, _hash(x)));
+  }
+
+  template <class K>
+  const_iterator find(const K& x) const
+  {
+    return const_iterator(this, _find_index(x, _hash(x)));
+  }
+
+  template <class K>
+  size_type count(const K& x) const
+  {
+    return (_find_index(x, _hash(x)) != capacity_m) ? 1 : 0;
+  }
+
+  template <class K>
+  T& at(const K& k)
+  {
+    size_type index = _find_index(k, _hash(k));
+
+    if (index == capacity_m) {
+      throw out_of_range("K is not found");
+    }
+
+    return slots_m[index].second;
+  }
+
+  /**
+   * \brief Returns the hash function object.
+   */
+  hasher hash_function() const
+  {
+    return hash_m;
+  }
+
+  /**
+   * \brief Returns the number of slots.
+   */
+  size_type bucket_count() const
+  {
+    return capacity_m;
+  }
+
+  /**
+   * \brief Returns the fraction of slots holding an element.
+   */
+  float load_factor() const
+  {
+    return capacity_m == 0 ? 0.0f : (float) size_m / capacity_m;
+  }
+
+  /**
+   * \brief Returns the load factor past which the table grows.
+   */
+  float max_load_factor() const
+  {
+    return max_load_factor_m;
+  }
+
+  /**
+   * \brief Sets the load factor past which the table grows, at most
+   * 0.875 so every probe sequence meets an EMPTY slot.
+   */
+  void max_load_factor(float ml)
+  {
+    if (ml <= 0 || ml > 0.875f) {
+      throw invalid_argument("max load factor must be in (0, 0.875]");
+    }
+
+    max_load_factor_m = ml;
+    reserve(size_m);
+  }
+
+  /**
+   * \brief Moves the elements into at least n slots, and at least enough
+   * to respect the max load factor, dropping DELETED slots.
+   * Invalidates iterators and references.
+   */
+  void rehash(size_type n)
+  {
+    size_type needed = (size_type) (size_m / max_load_factor_m) + 1;
+    if (n < needed) {
+      n = needed;
+    }
+
+    size_type new_capacity = GROUP_WIDTH;
+    while (new_capacity < n) {
+      new_capacity *= 2;
+    }
+
+    ctrl_type* old_ctrl = ctrl_m;
+    value_type* old_slots = slots_m;
+    size_type old_capacity = capacity_m;
+    size_type old_size = size_m;
+
+    _allocate(new_capacity);
+    size_m = old_size;
+
+    for (size_type i = 0; i < old_capacity; ++i) {
+      if (old_ctrl[i] >= 0) {
+	size_t hashvalue = _hash(old_slots[i].first);
+	size_type index = _find_insert_index(hashvalue);
+	::new (slots_m + index) value_type(old_slots[i]);
+	_set_ctrl(index, _h2(hashvalue));
+	old_slots[i].~value_type();
+      }
+    }
+
+    delete [] old_ctrl;
+    ::operator delete(old_slots);
+  }
+
+  /**
+   * \brief Makes room for n elements without exceeding the max load factor.
+   */
+  void reserve(size_type n)
+  {
+    if (n > 0 && n + deleted_m > capacity_m * max_load_factor_m) {
+      rehash(n);
+    }
+  }
+
+private:
+  /**
+   * \brief Hashs a given key with the hash function object.
+   */
+  template <class K>
+  size_t _hash(const K& k) const
+  {
+    return hash_m(k);
+  }
+
+  /**
+   * \brief Gets the part of the hash that picks the first slot probed.
+   */
+  static size_t _h1(size_t hashvalue)
+  {
+    return hashvalue >> 7;
+  }
+
+  /**
+   * \brief Gets the part of the hash stored in the control byte.
+   */
+  static ctrl_type _h2(size_t hashvalue)
+  {
+    return (ctrl_type) (hashvalue & 0x7f);
+  }
+
+  /**
+   * \brief Gets the index of the lowest set bit of a non-zero mask.
+   */
+  static size_type _lowest_bit(unsigned int mask)
+  {
+#ifdef __GNUC__
+    return __builtin_ctz(mask);
+#else
+    size_type i = 0;
+    while ((mask & 1) == 0) {
+      mask >>= 1;
+      ++i;
+    }
+    return i;
+#endif
+  }
+
+  /**
+   * \brief Finds the slot of a key whose hash is already known.
+   * Groups are probed at triangular offsets, which visits every group of
+   * a power of 2 table.
+   * \return The slot index, capacity_m if not found.
+   */
+  template <class K>
+  size_type _find_index(const K& k, size_t hashvalue) const
+  {
+    if (capacity_m == 0) {
+      return capacity_m;
+    }
+
+    size_type mask = capacity_m - 1;
+    size_type pos = _h1(hashvalue) & mask;
+    ctrl_type h2 = _h2(hashvalue);
+
+    for (size_type step = GROUP_WIDTH; ; step += GROUP_WIDTH) {
+      Group group(ctrl_m + pos);
+
+      for (unsigned int match = group.match(h2); match != 0; match &= match - 1) {
+	size_type index = (pos + _lowest_bit(match)) & mask;
+	if (slots_m[index].first == k) {
+	  return index;
+	}
+      }
+
+      if (group.match_empty() != 0) {
+	return capacity_m;
+      }
+
+      pos = (pos + step) & mask;
+    }
+  }
+
+  /**
+   * \brief Finds the slot of a key in one pass over its probe sequence,
+   * noting on the way where it would be inserted.
+   * \return The slot index and true if found, else the first EMPTY or
+   *   DELETED slot of the sequence (capacity_m if unallocated) and false.
+   */
+  template <class K>
+  pair<size_type, bool> _probe(const K& k, size_t hashvalue) const
+  {
+    if (capacity_m == 0) {
+      return pair<size_type, bool>(capacity_m, false);
+    }
+
+    size_type mask = capacity_m - 1;
+    size_type pos = _h1(hashvalue) & mask;
+    ctrl_type h2 = _h2(hashvalue);
+    size_type insert_index = capacity_m;
+
+    for (size_type step = GROUP_WIDTH; ; step += GROUP_WIDTH) {
+      Group group(ctrl_m + pos);
+
+      for (unsigned int match = group.match(h2); match != 0; match &= match - 1) {
+	size_type index = (pos + _lowest_bit(match)) & mask;
+	if (slots_m[index].first == k) {
+	  return pair<size_type, bool>(index, true);
+	}
+      }
+
+      if (insert_index == capacity_m) {
+	unsigned int available = group.match_empty_or_deleted();
+	if (available != 0) {
+	  insert_index = (pos + _lowest_bit(available)) & mask;
+	}
+      }
+
+      if (group.match_empty() != 0) {
+	return pair<size_type, bool>(insert_index, false);
+      }
+
+      pos = (pos + step) & mask;
+    }
+  }
+
+  /**
+   * \brief Gets the slot for a new element, growing the table first if
+   * needed (only then is the probe sequence walked again).
+   * \param index The free slot found by _probe().
+   * \return The slot to construct the element in; the caller calls
+   *   _occupy() once the element is built.
+   */
+  size_type _claim(size_type index, size_t hashvalue)
+  {
+    if (size_m + deleted_m + 1 > capacity_m * max_load_factor_m) {
+      // mostly DELETED slots: rehashing in place is enough
+      rehash(size_m + 1 > capacity_m * max_load_factor_m / 2 ?
+	     2 * capacity_m : capacity_m);
+      index = _find_insert_index(hashvalue);
+    }
+
+    return index;
+  }
+
+  /**
+   * \brief Marks the slot of a newly built element full.
+   */
+  void _occupy(size_type index, size_t hashvalue)
+  {
+    if (ctrl_m[index] == DELETED) {
+      --deleted_m;
+    }
+    _set_ctrl(index, _h2(hashvalue));
+    ++size_m;
+  }
+
+  /**
+   * \brief Inserts an element with key k and a value built from args,
+   * unless k is already in the map; the shared body of insert and
+   * try_emplace.
+   */
+  template <class... Args>
+  pair<iterator,bool> _try_emplace(const Key& k, Args&&... args)
+  {
+    size_t hashvalue = _hash(k);
+    pair<size_type, bool> probe_pair = _probe(k, hashvalue);
+
+    if (probe_pair.second) {
+      return pair<iterator, bool>(iterator(this, probe_pair.first), false);
+    }
+
+    size_type index = _claim(probe_pair.first, hashvalue);
+    ::new (slots_m + index) value_type(std::forward<Args>(args)...);
+    _occupy(index, hashvalue);
+
+    return pair<iterator, bool>(iterator(this, index), true);
+  }
+
+  /**
+   * \brief Finds the first EMPTY or DELETED slot on the probe sequence of
+   * a hash. The table must have such a slot.
+   */
+  size_type _find_insert_index(size_t hashvalue) const
+  {
+    size_type mask = capacity_m - 1;
+    size_type pos = _h1(hashvalue) & mask;
+
+    for (size_type step = GROUP_WIDTH; ; step += GROUP_WIDTH) {
+      unsigned int match = Group(ctrl_m + pos).match_empty_or_deleted();
+      if (match != 0) {
+	return (pos + _lowest_bit(match)) & mask;
+      }
+
+      pos = (pos + step) & mask;
+    }
+  }
+
+  /**
+   * \brief Sets a control byte and its copy past the end, if any.
+   */
+  void _set_ctrl(size_type index, ctrl_type c)
+  {
+    ctrl_m[index] = c;
+    if (index < GROUP_WIDTH) {
+      ctrl_m[capacity_m + index] = c;
+    }
+  }
+
+  /**
+   * \brief Used for iteration.
+   * \return The index of the first full slot from index on, capacity_m
+   *   if there is none.
+   */
+  size_type _next_full(size_type index) const
+  {
+    while (index < capacity_m && ctrl_m[index] < 0) {
+      ++index;
+    }
+    return index;
+  }
+
+  /**
+   * \brief Destroys the element of a full slot and marks it DELETED.
+   */
+  void _erase_index(size_type index)
+  {
+    slots_m[index].~value_type();
+    _set_ctrl(index, DELETED);
+    --size_m;
+    ++deleted_m;
+  }
+
+  /**
+   * \brief Allocates an all-EMPTY table of n slots, forgetting the old one.
+   */
+  void _allocate(size_type n)
+  {
+    ctrl_m = new ctrl_type[n + GROUP_WIDTH];
+    memset(ctrl_m, EMPTY, n + GROUP_WIDTH);
+    slots_m = static_cast<value_type*>(::operator new(n * sizeof(value_type)));
+    capacity_m = n;
+    size_m = 0;
+    deleted_m = 0;
+  }
+
+  /**
+   * \brief Destroys every element and frees the table.
+   */
+  void _destroy()
+  {
+    clear();
+    delete [] ctrl_m;
+    ::operator delete(slots_m);
+    ctrl_m = NULL;
+    slots_m = NULL;
+    capacity_m = 0;
+  }
+
+  /**
+   * \brief Exchanges two members, see swap().
+   */
+  template <class M>
+  static void _swap_member(M& a, M& b)
+  {
+    M temp = a;
+    a = b;
+    b = temp;
+  }
+
+  /**
+   * \brief Copies the elements of x into this empty, unallocated map,
+   * slot by slot: both tables have the same capacity and hash function,
+   * so every element keeps its slot.
+   */
+  void _copy_from(const Self& x)
+  {
+    if (x.capacity_m == 0) {
+      return;
+    }
+
+    _allocate(x.capacity_m);
+    memcpy(ctrl_m, x.ctrl_m, capacity_m + GROUP_WIDTH);
+    for (size_type i = 0; i < capacity_m; ++i) {
+      if (ctrl_m[i] >= 0) {
+	::new (slots_m + i) value_type(x.slots_m[i]);
+      }
+    }
+    size_m = x.size_m;
+    deleted_m = x.deleted_m;
+  }
+};
+
+#endif // FLATHASHMAP_HPP
@@ -0,0 +1,170 @@
+/**
+ * \file hashcons.cpp
+ *
+ * Implementation of the hash-consing table for immutable parsed data.
+ */
+
+#include "hashcons.hpp"
+#include "heap.hpp"
+#include "cons.hpp"
+#include <cstring>
+
+using namespace std;
+
+// Interned data by structural key, see hashcons_key().
+//   Weak: entries of unreachable data are dropped by every collection.
+static hashtablemap<string, Cell*> hashcons_table;
+
+static bool hashcons_on = false;
+
+// Bytes of duplicates that were replaced by an interned datum.
+static size_t hashcons_saved = 0;
+
+// Number of duplicates that were replaced by an interned datum.
+static size_t hashcons_hits = 0;
+
+/**
+ * \brief Drops the entries of data that the current collection did not
+ * mark, so the table never keeps data alive on its own.
+ */
+static void hashcons_sweep()
+{
+  vector<string> dead_keys;
+  for (hashtablemap<string, Cell*>::iterator it = hashcons_table.begin();
+       it != hashcons_table.end(); ++it) {
+    if (!it->second->is_marked()) {
+      dead_keys.push_back(it->first);
+    }
+  }
+
+  for (size_t i = 0; i < dead_keys.size(); ++i) {
+    hashcons_table.erase(dead_keys[i]);
+  }
+}
+
+void hashcons_enable(const bool enabled)
+{
+  static bool hook_added = false;
+
+  if (enabled && !hook_added) {
+    heap_add_sweep_hook(hashcons_sweep);
+    hook_added = true;
+  }
+  hashcons_on = enabled;
+}
+
+bool hashcons_enabled()
+{
+  return hashcons_on;
+}
+
+/**
+ * \brief Builds the structural key of an atom.
+ * \param c An int, double or symbol cell.
+ * \return The key, equal for equal atoms of the same type.
+ */
+static string hashcons_key(Cell* const c)
+{
+  stringstream ss;
+
+  if (intp(c)) {
+    ss << "i" << get_int(c);
+  } else if (doublep(c)) {
+    // Key on the exact bits, printing would round.
+    double d = get_double(c);
+    unsigned long long bits = 0;
+    memcpy(&bits, &d, sizeof(d));
+    ss << "d" << hex << bits;
+  } else {
+    ss << "s" << get_symbol(c);
+  }
+
+  return ss.str();
+}
+
+/**
+ * \brief Looks up a key, recording a hit or storing the new datum.
+ * \param key The structural key of the datum.
+ * \param c The datum.
+ * \param bytes The size of the datum, not counting its sub-data.
+ * \return The interned datum.
+ */
+static Cell* hashcons_lookup(const string& key, Cell* const c, const size_t bytes)
+{
+  pair<hashtablemap<string, Cell*>::iterator, bool> itbool_pair =
+    hashcons_table.insert(pair<string, Cell*>(key, c));
+
+  if (itbool_pair.second == false) {
+    ++hashcons_hits;
+    hashcons_saved += bytes;
+    return itbool_pair.first->second;
+  }
+
+  return c;
+}
+
+Cell* hashcons(Cell* const c)
+{
+  if (nullp(c) || operatorp(c) || procedurep(c)) {
+    // Not data.
+    return c;
+  }
+
+  if (intp(c)) {
+    return hashcons_lookup(hashcons_key(c), c, sizeof(IntCell));
+  } else if (doublep(c)) {
+    return hashcons_lookup(hashcons_key(c), c, sizeof(DoubleCell));
+  } else if (symbolp(c)) {
+    return hashcons_lookup(hashcons_key(c), c,
+			   sizeof(SymbolCell) + strlen(c->get_symbol()) + 1);
+  }
+
+  // A list: intern the elements first, then key on their addresses.
+  vector<Cell*> elems;
+  bool changed = false;
+  bool compact = true;
+  Cell* curr = c;
+  while (consp(curr)) {
+    Cell* elem = hashcons(car(curr));
+    changed = changed || elem != car(curr);
+    compact = compact && curr->get_cdr_code() != cdr_normal;
+    elems.push_back(elem);
+    curr = cdr(curr);
+  }
+  Cell* tail = hashcons(curr);
+  changed = changed || tail != curr;
+
+  stringstream ss;
+  ss << "l";
+  for (size_t i = 0; i < elems.size(); ++i) {
+    ss << " " << (void*) elems[i];
+  }
+  ss << " . " << (void*) tail;
+
+  Cell* result = c;
+  if (changed) {
+    if (nullp(tail)) {
+      result = make_list(elems);
+    } else {
+      result = tail;
+      for (size_t i = elems.size(); i > 0; --i) {
+	result = cons(elems[i - 1], result);
+      }
+    }
+  }
+
+  size_t bytes = elems.size() * (compact ? sizeof(CompactConsCell) : sizeof(ConsCell));
+  return hashcons_lookup(ss.str(), result, bytes);
+}
+
+size_t hashcons_saved_bytes()
+{
+  return hashcons_saved;
+}
+
+void hashcons_report(ostream& os)
+{
+  os << "hash-consing: " << hashcons_table.size() << " interned data, "
+     << hashcons_hits << " duplicates shared, "
+     << hashcons_saved_bytes() << " bytes saved" << endl;
+}
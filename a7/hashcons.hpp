@@ -0,0 +1,51 @@
+/**
+ * \file hashcons.hpp
+ *
+ * Encapsulates the interface for the optional hash-consing of immutable
+ * literal and quoted data produced by the parser: structurally identical
+ * data is stored once, so comparing two interned data is a pointer compare.
+ */
+
+#ifndef HASHCONS_HPP
+#define HASHCONS_HPP
+
+#include <cstddef>
+#include <iostream>
+
+using namespace std;
+
+class Cell;
+
+/**
+ * \brief Turns hash-consing of parsed data on or off (off by default).
+ * \param enabled True to intern literals and quoted data.
+ */
+void hashcons_enable(const bool enabled);
+
+/**
+ * \brief Check if hash-consing is turned on.
+ * \return True iff parsed data is being interned.
+ */
+bool hashcons_enabled();
+
+/**
+ * \brief Interns an immutable datum and all of its sub-data.
+ * \param c The datum.
+ * \return The stored datum structurally equal to c, c itself if new.
+ */
+Cell* hashcons(Cell* const c);
+
+/**
+ * \brief Gets the number of bytes of duplicate data not kept thanks to
+ * hash-consing.
+ * \return The number of bytes saved.
+ */
+size_t hashcons_saved_bytes();
+
+/**
+ * \brief Prints the number of interned data and the memory saved.
+ * \param os The output stream to print to.
+ */
+void hashcons_report(ostream& os);
+
+#endif // HASHCONS_HPP
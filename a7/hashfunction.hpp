@@ -0,0 +1,125 @@
+#ifndef HASHFUNCTION_HPP
+#define HASHFUNCTION_HPP
+
+/**
+ * \file hashfunction.hpp
+ *
+ * Default hash functions for the hash maps: FNV-1a for strings and any
+ * other key printable to a stream, and a bit mixer for integral keys.
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <sstream>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+using namespace std;
+
+/**
+ * \brief Hashes a byte sequence with 64-bit FNV-1a.
+ * \param bytes The bytes to hash.
+ * \param length The number of bytes.
+ * \return The hash value.
+ */
+inline size_t fnv1a_hash(const char* bytes, size_t length)
+{
+  unsigned long long hashvalue = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; ++i) {
+    hashvalue ^= (unsigned char) bytes[i];
+    hashvalue *= 1099511628211ULL;
+  }
+  return (size_t) hashvalue;
+}
+
+/**
+ * \brief Scrambles the bits of an integer (the splitmix64 finalizer), so
+ * that keys differing only in their high bits land in different buckets.
+ * \param x The integer to scramble.
+ * \return The hash value.
+ */
+inline size_t mix_hash(unsigned long long x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return (size_t) x;
+}
+
+/**
+ * \struct default_hash
+ * \brief Hash function object for keys printable to a stream: hashes
+ * the printed form. Faster specializations follow for common keys.
+ */
+template <class Key>
+struct default_hash {
+  size_t operator()(const Key& k) const
+  {
+    stringstream ss;
+    ss << k;
+    const string str = ss.str();
+    return fnv1a_hash(str.data(), str.size());
+  }
+};
+
+/**
+ * \brief Hashes strings, C strings and string views alike, so a map with
+ * string keys can be searched with any of them (heterogeneous lookup).
+ */
+template <>
+struct default_hash<string> {
+  size_t operator()(const string& k) const
+  {
+    return fnv1a_hash(k.data(), k.size());
+  }
+
+  size_t operator()(const char* k) const
+  {
+    return fnv1a_hash(k, strlen(k));
+  }
+
+#if __cplusplus >= 201703L
+  size_t operator()(string_view k) const
+  {
+    return fnv1a_hash(k.data(), k.size());
+  }
+#endif
+};
+
+template <>
+struct default_hash<const char*> {
+  size_t operator()(const char* k) const
+  {
+    return fnv1a_hash(k, strlen(k));
+  }
+};
+
+#define DEFAULT_HASH_INTEGRAL(type)				\
+  template <>							\
+  struct default_hash<type> {					\
+    size_t operator()(type k) const				\
+    {								\
+      return mix_hash((unsigned long long) k);			\
+    }								\
+  };
+
+DEFAULT_HASH_INTEGRAL(bool)
+DEFAULT_HASH_INTEGRAL(char)
+DEFAULT_HASH_INTEGRAL(signed char)
+DEFAULT_HASH_INTEGRAL(unsigned char)
+DEFAULT_HASH_INTEGRAL(short)
+DEFAULT_HASH_INTEGRAL(unsigned short)
+DEFAULT_HASH_INTEGRAL(int)
+DEFAULT_HASH_INTEGRAL(unsigned int)
+DEFAULT_HASH_INTEGRAL(long)
+DEFAULT_HASH_INTEGRAL(unsigned long)
+DEFAULT_HASH_INTEGRAL(long long)
+DEFAULT_HASH_INTEGRAL(unsigned long long)
+
+#undef DEFAULT_HASH_INTEGRAL
+
+#endif // HASHFUNCTION_HPP
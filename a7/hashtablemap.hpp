@@ -20,17 +20,27 @@
 #include <cstddef>
 #include <sstream>
 #include <cmath>
+#include <tuple>
+#include <memory>
+#include <new>
 
 #include "bstmap.hpp"
+#include "hashfunction.hpp"
+#include "poolallocator.hpp"
 
-template <class Key, class T>
+template <class Key, class T, class Hash = default_hash<Key>,
+	  class Alloc = pool_allocator<pair<const Key, T> > >
 /**
  * \class hashtablemap
  * \brief Class hashtablemap
+ *
+ * Nodes, bucket tree nodes and bucket arrays are all allocated with
+ * Alloc rebound to their type; the default pool_allocator recycles them,
+ * so a map built and destroyed per procedure call does not call malloc.
  */
 class hashtablemap
 {
-  typedef hashtablemap<Key, T>     Self;
+  typedef hashtablemap<Key, T, Hash, Alloc> Self;
 
 public:
   typedef Key                key_type;
@@ -38,6 +48,8 @@ public:
   typedef pair<const Key, T> value_type;
   typedef unsigned int       size_type;
   typedef int                difference_type;
+  typedef Hash               hasher;
+  typedef Alloc              allocator_type;
 
 private:
   /**
@@ -48,23 +60,67 @@ private:
    */
   struct Node {
   public:
-    Node(value_type val) : value_m(val) {}
+    Node(value_type val, size_t hash)
+      : value_m(val), hash_m(hash), prev_m(NULL), next_m(NULL) {}
+    // constructs the value in place from args.
+    template <class... Args>
+    Node(size_t hash, Args&&... args)
+      : value_m(std::forward<Args>(args)...), hash_m(hash), prev_m(NULL), next_m(NULL) {}
     value_type value_m;
+    // full hash of the key, so rehashing never recomputes it.
+    size_t hash_m;
+    // neighbours in the list of all nodes, in insertion order
+    //  (a copy lists them in bucket order).
+    Node* prev_m;
+    Node* next_m;
   };
 
-  typedef bstmap<Key, Node*> bucket_type;
+  typedef typename allocator_traits<Alloc>::template rebind_alloc<Node> node_allocator;
+  typedef bstmap<Key, Node*,
+		 typename allocator_traits<Alloc>::template rebind_alloc<pair<const Key, Node*> > >
+  bucket_type;
+  typedef typename allocator_traits<Alloc>::template rebind_alloc<bucket_type> table_allocator;
+
+  // allocates the nodes; rebound, the bucket arrays too.
+  //  Declared first: the constructors allocate the table with it.
+  node_allocator alloc_m;
 
   // Hash Table array of bstmaps.
   bucket_type* table_m;
 
+  // holds the number of buckets in table_m.
+  size_type bucket_count_m;
+
   // holds the number of values/elements in map
-  // note: size_m =/= TABLE_SIZE.
+  // note: size_m =/= bucket_count_m.
   size_type size_m;
 
+  // the table grows when size_m / bucket_count_m would exceed this.
+  float max_load_factor_m;
+
+  // hash function object.
+  Hash hash_m;
+
+  // first and last nodes of the list of all nodes, which iterators walk.
+  Node* head_m;
+  Node* tail_m;
+
+  // true to spread growth over the following operations, see incremental_rehash().
+  bool incremental_m;
+
+  // during an incremental rehash, the table being emptied (NULL otherwise),
+  //  its number of buckets, and how many of its buckets were moved so far.
+  bucket_type* old_table_m;
+  size_type old_bucket_count_m;
+  size_type migrated_m;
+
+  // old buckets moved per insert, erase or non-const lookup.
+  //  More than 1 so the move ends well before the next growth.
+  size_type static const REHASH_STEP = 4;
+
   // strings hash well with constants 31, 33, 37, 39, 41 well with less than 7 collisions.
   //  41 arbitrarily chosen because it's the largest of the list, prime, and 42 - 1
-  size_type static const TABLE_SIZE = 41;
-
+  size_type static const DEFAULT_BUCKET_COUNT = 41;
 
 
 public:
@@ -132,7 +188,7 @@ public:
     // Sets the node to the next successor node.
     _iterator& operator++() 
     {
-      node_m = table_m->_successor_node(node_m);
+      node_m = node_m->next_m;
       return (*this);
     }
 
@@ -165,16 +221,39 @@ public:
 public:
   ///\brief Default constructor to create an empty map
   hashtablemap() 
-    : table_m(new bucket_type[TABLE_SIZE]), size_m(0) {}
+    : table_m(_new_table(DEFAULT_BUCKET_COUNT)),
+      bucket_count_m(DEFAULT_BUCKET_COUNT), size_m(0), max_load_factor_m(1.0f),
+      head_m(NULL), tail_m(NULL), incremental_m(false), old_table_m(NULL),
+      old_bucket_count_m(0), migrated_m(0) {}
+
+  ///\brief Constructor to create an empty map with at least n buckets.
+  explicit hashtablemap(size_type n)
+    : table_m(_new_table(n > 0 ? n : 1)),
+      bucket_count_m(n > 0 ? n : 1), size_m(0), max_load_factor_m(1.0f),
+      head_m(NULL), tail_m(NULL), incremental_m(false), old_table_m(NULL),
+      old_bucket_count_m(0), migrated_m(0) {}
 
   ///\brief Copy constructor with deep copying.
   hashtablemap(const Self& x)
-    : table_m(new bucket_type[TABLE_SIZE]), size_m(0)
+    : alloc_m(x.alloc_m), table_m(_new_table(x.bucket_count_m)),
+      bucket_count_m(x.bucket_count_m), size_m(0),
+      max_load_factor_m(x.max_load_factor_m), hash_m(x.hash_m),
+      head_m(NULL), tail_m(NULL), incremental_m(x.incremental_m),
+      old_table_m(NULL), old_bucket_count_m(0), migrated_m(0)
   {
-    // Manual reinsert into a new table.
-    for (const_iterator i = x.begin(); i != x.end(); ++i) {
-      insert(*i);
-    }
+    _copy_buckets(x);
+  }
+
+  ///\brief Move constructor: takes x's table and nodes in O(1).
+  /// x is left empty with no buckets; it grows again on its next insert.
+  hashtablemap(Self&& x) noexcept
+    : alloc_m(x.alloc_m), table_m(x.table_m), bucket_count_m(x.bucket_count_m), size_m(x.size_m),
+      max_load_factor_m(x.max_load_factor_m), hash_m(x.hash_m),
+      head_m(x.head_m), tail_m(x.tail_m), incremental_m(x.incremental_m),
+      old_table_m(x.old_table_m), old_bucket_count_m(x.old_bucket_count_m),
+      migrated_m(x.migrated_m)
+  {
+    x._forget();
   }
 
   /**
@@ -182,7 +261,9 @@ public:
    */
   ~hashtablemap()
   {
-    delete [] table_m;
+    _delete_nodes();
+    _delete_table(table_m, bucket_count_m);
+    _delete_table(old_table_m, old_bucket_count_m);
   }
 
   ///\brief Assignment operator with deep copying.
@@ -192,48 +273,51 @@ public:
       return *this;
     }
 
-    // Make anew before inserting.
-    clear();
-    
-    for (const_iterator i = x.begin(); i != x.end(); ++i) {
-      insert(*i);      /// same balancing problem as for copy constructor above
+    // Copy first, so *this is untouched if copying throws.
+    Self copy(x);
+    swap(copy);
+    return *this;
+  }
+
+  ///\brief Move assignment: takes x's table and nodes in O(1).
+  Self& operator=(Self&& x) noexcept {
+    if (this != &x) {
+      Self temp(static_cast<Self&&>(x));
+      swap(temp);
     }
+    return *this;
+  }
+
+  /**
+   * \brief Exchanges the contents of two maps in O(1).
+   */
+  void swap(Self& x) noexcept {
+    _swap_member(alloc_m, x.alloc_m);
+    _swap_member(table_m, x.table_m);
+    _swap_member(bucket_count_m, x.bucket_count_m);
+    _swap_member(size_m, x.size_m);
+    _swap_member(max_load_factor_m, x.max_load_factor_m);
+    _swap_member(hash_m, x.hash_m);
+    _swap_member(head_m, x.head_m);
+    _swap_member(tail_m, x.tail_m);
+    _swap_member(incremental_m, x.incremental_m);
+    _swap_member(old_table_m, x.old_table_m);
+    _swap_member(old_bucket_count_m, x.old_bucket_count_m);
+    _swap_member(migrated_m, x.migrated_m);
   }
 
   /** 
-   * \brief Returns an iterator to the first non-empty bucket.
+   * \brief Returns an iterator to the first node.
    */
   iterator begin() {
-    if (empty()) {
-      return end();
-    }
-
-    // Finds the first node in the first non-empty bucket
-    const bucket_type* first_filled_bucket = _find_next_nonempty_bucket();
-
-    // First filled bucket cannot be NULL, else the whole table should be empty() == true.
-    // Node* bstmap::begin()
-    Node* first_node = first_filled_bucket->begin()->second;
-    
-    return iterator(this, first_node);
+    return iterator(this, head_m);
   }
 
   /** 
-   * \brief Returns a const iterator to the first non-empty bucket.
+   * \brief Returns a const iterator to the first node.
    */  
   const_iterator begin() const {
-    if (empty()) {
-      return end();
-    }
-
-    // Finds the first node in the first non-empty bucket
-    const bucket_type* first_filled_bucket = _find_next_nonempty_bucket();
-
-    // First filled bucket cannot be NULL, else the whole table should be empty() == true.
-    // bstmap->begin()
-    Node* first_node = first_filled_bucket->begin()->second;
-    
-    return const_iterator(this, first_node);
+    return const_iterator(this, head_m);
   }
 
   /** 
@@ -272,27 +356,101 @@ public:
 
   /** 
    * \brief Inserts an element by a given pair
+   * \return An iterator to the element with the key of x, and true iff
+   *   x was inserted.
    */  
   pair<iterator,bool> insert(const value_type& x) 
   {
-    iterator it = find(x.first);
+    return _try_emplace(x.first, x);
+  }
 
-    // element exists already
-    //  find() returns end() if element does not exist.
-    if (it != end()) {
-      return pair<iterator, bool>(iterator(this, it.node_m), false);
-    } else {
-      // insert new node
-      int hashvalue = _hash(x.first);
-      Node* new_node = new Node(x);
-      
-      const pair<Key, Node*> keynodepair(x.first, new_node);
-      table_m[hashvalue].insert(keynodepair);
+  /**
+   * \brief Inserts an element constructed in place from args, unless
+   * its key is already in the map.
+   * \return An iterator to the element with that key, and true iff the
+   *   new element was inserted.
+   */
+  template <class... Args>
+  pair<iterator,bool> emplace(Args&&... args)
+  {
+    // The key is only known once the element is built.
+    Node* new_node = _new_node(0, std::forward<Args>(args)...);
+    new_node->hash_m = _hash(new_node->value_m.first);
+
+    pair<Node**, bool> slot_pair;
+    try {
+      slot_pair = _probe(new_node->value_m.first, new_node->hash_m);
+    } catch (...) {
+      _delete_node(new_node);
+      throw;
+    }
+
+    if (!slot_pair.second) {
+      _delete_node(new_node);
+      return pair<iterator, bool>(iterator(this, *slot_pair.first), false);
+    }
+
+    return pair<iterator, bool>(iterator(this, _fill(slot_pair.first, new_node)), true);
+  }
+
+  /**
+   * \brief Inserts an element with key k and a value constructed from
+   * args, unless k is already in the map; then args are left untouched.
+   * \return An iterator to the element with key k, and true iff the
+   *   new element was inserted.
+   */
+  template <class... Args>
+  pair<iterator,bool> try_emplace(const Key& k, Args&&... args)
+  {
+    return _try_emplace(k, piecewise_construct, forward_as_tuple(k),
+			forward_as_tuple(std::forward<Args>(args)...));
+  }
 
-      ++size_m;
+  /**
+   * \brief Inserts an element with key k and value obj, or assigns obj
+   * to the value of k if it is already in the map.
+   * \return An iterator to the element with key k, and true iff the
+   *   new element was inserted.
+   */
+  template <class M>
+  pair<iterator,bool> insert_or_assign(const Key& k, M&& obj)
+  {
+    size_t hashvalue = _hash(k);
+    pair<Node**, bool> slot_pair = _probe(k, hashvalue);
 
-      return pair<iterator, bool>(iterator(this, it.node_m), true);
+    if (!slot_pair.second) {
+      (*slot_pair.first)->value_m.second = std::forward<M>(obj);
+      return pair<iterator, bool>(iterator(this, *slot_pair.first), false);
     }
+
+    Node* new_node = _make_node(k, hashvalue, k, std::forward<M>(obj));
+    return pair<iterator, bool>(iterator(this, _fill(slot_pair.first, new_node)), true);
+  }
+
+  /**
+   * \brief Inserts an element by a given pair, like insert(x). Elements
+   * are not kept in key order, so the hint only helps when it already
+   * points at x's key: then neither hashing nor probing is needed.
+   * \return An iterator to the element with the key of x.
+   */
+  iterator insert(iterator hint, const value_type& x)
+  {
+    if (hint.node_m != NULL && hint.node_m->value_m.first == x.first) {
+      return hint;
+    }
+    return insert(x).first;
+  }
+
+  /**
+   * \brief Inserts an element constructed in place from args, like
+   * emplace(args...); the hint is ignored, as the key is only known once
+   * the element is built.
+   * \return An iterator to the element with the element's key.
+   */
+  template <class... Args>
+  iterator emplace_hint(iterator hint, Args&&... args)
+  {
+    return emplace(std::forward<Args>(args)...).first;
   }
 
   /**
@@ -317,43 +475,174 @@ public:
       return 0;
     }
     
-    int hashvalue = _hash(x);
-
-    table_m[hashvalue].erase(x);
+    if (old_table_m == NULL
+	|| old_table_m[it.node_m->hash_m % old_bucket_count_m].erase(x) == 0) {
+      table_m[_bucket(it.node_m->hash_m)].erase(x);
+    }
+    _unlink_node(it.node_m);
+    _delete_node(it.node_m);
     --size_m;
     
     return 1; // since Key in maps are unique, can only be 1
   }
   
   /**
-   * \brief Empty all buckets
+   * \brief Empty all buckets, keeping the bucket array.
    */
   void clear() {
     if (empty()) {
       return;
     }
 
-    delete [] table_m;
-    table_m = new bucket_type[TABLE_SIZE];
+    _delete_nodes();
+    for (size_type i = 0; i < bucket_count_m; ++i) {
+      table_m[i].clear();
+    }
+    _delete_table(old_table_m, old_bucket_count_m);
+    old_table_m = NULL;
+    old_bucket_count_m = 0;
+    migrated_m = 0;
     size_m = 0;
   }
 
+  /**
+   * \brief Returns a copy of the allocator.
+   */
+  allocator_type get_allocator() const
+  {
+    return allocator_type(alloc_m);
+  }
+
+  /**
+   * \brief Returns the hash function object.
+   */
+  hasher hash_function() const
+  {
+    return hash_m;
+  }
+
+  /**
+   * \brief Returns the number of buckets.
+   */
+  size_type bucket_count() const
+  {
+    return bucket_count_m;
+  }
+
+  /**
+   * \brief Returns the average number of elements per bucket.
+   */
+  float load_factor() const
+  {
+    return bucket_count_m == 0 ? 0.0f : (float) size_m / bucket_count_m;
+  }
+
+  /**
+   * \brief Returns the load factor past which the table grows.
+   */
+  float max_load_factor() const
+  {
+    return max_load_factor_m;
+  }
+
+  /**
+   * \brief Sets the load factor past which the table grows,
+   * growing the table right away if it is already exceeded.
+   */
+  void max_load_factor(float ml)
+  {
+    if (ml <= 0) {
+      throw invalid_argument("max load factor must be positive");
+    }
+
+    max_load_factor_m = ml;
+    reserve(size_m);
+  }
+
+  /**
+   * \brief Redistributes the elements into at least n buckets, and at
+   * least enough to respect the max load factor. Nodes are moved, not
+   * copied, so references to elements stay valid.
+   */
+  void rehash(size_type n)
+  {
+    _migrate(old_bucket_count_m);
+
+    size_type needed = (size_type) ceil(size_m / max_load_factor_m);
+    if (n < needed) {
+      n = needed;
+    }
+    if (n == 0) {
+      n = 1;
+    }
+    if (n == bucket_count_m) {
+      return;
+    }
+
+    bucket_type* old_table = table_m;
+    size_type old_count = bucket_count_m;
+
+    table_m = _new_table(n);
+    bucket_count_m = n;
+
+    for (Node* curr = head_m; curr; curr = curr->next_m) {
+      const pair<Key, Node*> keynodepair(curr->value_m.first, curr);
+      table_m[_bucket(curr->hash_m)].insert(keynodepair);
+    }
+
+    _delete_table(old_table, old_count);
+  }
+
+  /**
+   * \brief Turns incremental rehashing on or off (off by default).
+   * When on, growing allocates the larger table but leaves the elements
+   * in the old one, and every following insert, erase or non-const find
+   * moves REHASH_STEP old buckets over, so no single insert pays for
+   * rehashing the whole map. Turning it off finishes any pending move.
+   */
+  void incremental_rehash(bool on)
+  {
+    incremental_m = on;
+    if (!on) {
+      _migrate(old_bucket_count_m);
+    }
+  }
+
+  /**
+   * \brief Checks if incremental rehashing is on.
+   */
+  bool incremental_rehash() const
+  {
+    return incremental_m;
+  }
+
+  /**
+   * \brief Checks if an incremental rehash is in progress.
+   */
+  bool rehashing() const
+  {
+    return old_table_m != NULL;
+  }
+
+  /**
+   * \brief Makes room for n elements without exceeding the max load factor.
+   */
+  void reserve(size_type n)
+  {
+    size_type needed = (size_type) ceil(n / max_load_factor_m);
+    if (needed > bucket_count_m) {
+      rehash(needed);
+    }
+  }
+
   /** 
    * \brief Finds the element with given key.
    * \return An iterator pointing to the element found.
    *   returns end() if not found.
    */  
   iterator find(const Key& x) {
-    int hashvalue = _hash(x);
-    
-    bucket_type* ptr = table_m + hashvalue;
-    typename bucket_type::iterator it = ptr->find(x);
-
-    if (it == ptr->end()) {
-      return end();
-    }
-
-    return iterator(this, (*it).second);
+    _migrate(REHASH_STEP);
+    return iterator(this, _find_node(x, _hash(x)));
   }
 
   /** 
@@ -362,16 +651,7 @@ public:
    *    returns end() if not found.
    */  
   const_iterator find(const Key& x) const {
-    int hashvalue = _hash(x);
-    
-    bucket_type* ptr = table_m + hashvalue;
-    typename bucket_type::iterator it = ptr->find(x);
-
-    if (it == ptr->end()) {
-      return end();
-    }
-
-    return const_iterator(this, (*it).second);
+    return const_iterator(this, _find_node(x, _hash(x)));
   }
 
   /** 
@@ -392,16 +672,8 @@ public:
    */  
   T& operator[](const Key& k) 
   {
-    iterator it = find(k);
-
-    if (it != end()) {
-      // found key
-      return (*it).second;
-    } else {
-      // not found -> create empty
-      insert(value_type(k, T()));
-      return (*this)[k];
-    }
+    // Hashes and probes once, whether k is found or inserted.
+    return try_emplace(k).first->second;
   }
 
   /** 
@@ -421,69 +693,378 @@ public:
     }
   }
 
+  /** 
+   * \brief Finds the element with a key comparable to Key without
+   * converting it, e.g. a const char* or string_view for string keys.
+   * Hash must hash equal K and Key values equally.
+   */  
+  template <class K>
+  iterator find(const K& x) {
+    _migrate(REHASH_STEP);
+    return iterator(this, _find_node(x, _hash(x)));
+  }
+
+  template <class K>
+  const_iterator find(const K& x) const {
+    return const_iterator(this, _find_node(x, _hash(x)));
+  }
+
+  template <class K>
+  size_type count(const K& x) const 
+  {
+    return (_find_node(x, _hash(x)) != NULL) ? 1 : 0;
+  }
+
+  template <class K>
+  T& at(const K& k) 
+  {
+    Node* node = _find_node(k, _hash(k));
+
+    if (node == NULL) {
+      throw out_of_range("K is not found");
+    }
+
+    return node->value_m.second;
+  }
+
 private:
   
   /** 
-   * \brief Hashs a given key by turning into a string then hashs with
-   * hash = SUM((s[n]*128^n) mod TABLE_SIZE
+   * \brief Hashs a given key with the hash function object.
+   * \return The full hash, see _bucket() for the bucket index.
    */  
+  template <class K>
+  size_t _hash(const K& k) const
+  {
+    return hash_m(k);
+  }
 
-  int _hash(const Key& k) const
+  /**
+   * \brief Maps a full hash to a bucket index.
+   * \return A value between 0 and bucket_count_m
+   */
+  size_type _bucket(size_t hashvalue) const
   {
-    stringstream ss;
-    ss << k;
-    const char* c_str = ss.str().c_str();
-    int hashvalue = 5381;
-    double temp;
-    for(double i = 1; *c_str != '\0'; ++c_str, ++i) {
-      temp  = (*c_str)*pow(128.0, (double) i);
-      hashvalue += (int) floor(temp);
+    return hashvalue % bucket_count_m;
+  }
+
+  /**
+   * \brief Finds the node of a key whose hash is already known.
+   * \return The node, NULL if not found.
+   */
+  template <class K>
+  Node* _find_node(const K& k, size_t hashvalue) const
+  {
+    if (old_table_m != NULL) {
+      // the old bucket of k still holds its older elements
+      size_type old_bucket = hashvalue % old_bucket_count_m;
+      if (old_bucket >= migrated_m) {
+	typename bucket_type::iterator it = old_table_m[old_bucket].find(k);
+	if (it != old_table_m[old_bucket].end()) {
+	  return it->second;
+	}
+      }
+    }
+
+    if (bucket_count_m == 0) {
+      // moved from
+      return NULL;
+    }
+
+    bucket_type* ptr = table_m + _bucket(hashvalue);
+    typename bucket_type::iterator it = ptr->find(k);
+
+    if (it == ptr->end()) {
+      return NULL;
     }
-    
-    hashvalue %= TABLE_SIZE;
 
-    // returns a value between 0 and TABLE_SIZE (41)
-    return hashvalue;
+    return it->second;
   }
 
   /**
-   * \brief Finds the next nonempty bucket after a given index
-   * \return A const pointer to the first after a given index nonempty bucket.
+   * \brief Finds key k, or makes room for it, with one probe of its
+   * bucket: a new bucket entry is added with a NULL node, which the
+   * caller must set with _fill() or remove with _abandon_probe().
+   * \return The node field of k's bucket entry, and true iff it is new.
    */
-  const bucket_type* _find_next_nonempty_bucket(int const index = -1) const {
-    for (int i = index + 1; i < TABLE_SIZE; ++i) {
-      if (!table_m[i].empty()) {
-	return &table_m[i];
+  pair<Node**, bool> _probe(const Key& k, size_t hashvalue) {
+    _migrate(REHASH_STEP);
+
+    if (bucket_count_m == 0) {
+      // moved from
+      rehash(DEFAULT_BUCKET_COUNT);
+    }
+
+    if (old_table_m != NULL) {
+      // the old bucket of k still holds its older elements
+      size_type old_bucket = hashvalue % old_bucket_count_m;
+      if (old_bucket >= migrated_m) {
+	typename bucket_type::iterator it = old_table_m[old_bucket].find(k);
+	if (it != old_table_m[old_bucket].end()) {
+	  return pair<Node**, bool>(&it->second, false);
+	}
       }
     }
 
-    return NULL;
+    const pair<Key, Node*> keynodepair(k, NULL);
+    pair<typename bucket_type::iterator, bool> itbool_pair =
+      table_m[_bucket(hashvalue)].insert(keynodepair);
+    return pair<Node**, bool>(&itbool_pair.first->second, itbool_pair.second);
   }
 
   /**
-   * \brief Used for iteration.
-   * \return Node* returns NULL if there are no following Nodes
+   * \brief Removes the bucket entry _probe() added for k.
    */
-  Node* _successor_node(Node* n) const {    
-    Key k = n->value_m.first;
-    int hashvalue = _hash(k);
+  void _abandon_probe(const Key& k, size_t hashvalue) {
+    table_m[_bucket(hashvalue)].erase(k);
+  }
 
-    bucket_type* curr_bucket = table_m + hashvalue;
-    typename bucket_type::iterator next = ++(curr_bucket->find(k));
+  /**
+   * \brief Builds the node for the new bucket entry of key k,
+   * removing the entry again if building the value throws.
+   */
+  template <class... Args>
+  Node* _make_node(const Key& k, size_t hashvalue, Args&&... args) {
+    try {
+      return _new_node(hashvalue, std::forward<Args>(args)...);
+    } catch (...) {
+      _abandon_probe(k, hashvalue);
+      throw;
+    }
+  }
 
-    // is there an element in current bucket?
-    if (next != curr_bucket->end()) {
-      return next->second;
+  /**
+   * \brief Inserts a node with key k and a value built from args, unless
+   * k is already in the map; the shared body of insert and try_emplace.
+   */
+  template <class... Args>
+  pair<iterator,bool> _try_emplace(const Key& k, Args&&... args) {
+    size_t hashvalue = _hash(k);
+    pair<Node**, bool> slot_pair = _probe(k, hashvalue);
+
+    if (!slot_pair.second) {
+      return pair<iterator, bool>(iterator(this, *slot_pair.first), false);
     }
 
-    const bucket_type* next_bucket = _find_next_nonempty_bucket(hashvalue);
-      
-    if (!next_bucket) {
-      return NULL;
+    Node* new_node = _make_node(k, hashvalue, std::forward<Args>(args)...);
+    return pair<iterator, bool>(iterator(this, _fill(slot_pair.first, new_node)), true);
+  }
+
+  /**
+   * \brief Stores a new node in the bucket entry made by _probe(), then
+   * grows the table if the load factor is now exceeded. Growing moves
+   * bucket entries but not nodes, so the node stays valid.
+   * \return The node.
+   */
+  Node* _fill(Node** slot, Node* new_node) {
+    *slot = new_node;
+    _link_node(new_node);
+    ++size_m;
+
+    if (size_m > bucket_count_m * max_load_factor_m) {
+      if (incremental_m) {
+	_start_migration(2 * bucket_count_m + 1);
+      } else {
+	rehash(2 * bucket_count_m + 1);
+      }
     }
 
-    // return first node of next non-empty bucket
-    return next_bucket->begin()->second;
+    return new_node;
+  }
+
+  /**
+   * \brief Starts an incremental rehash into n buckets, finishing any
+   * pending one first. New elements go to the new table right away.
+   */
+  void _start_migration(size_type n) {
+    _migrate(old_bucket_count_m);
+
+    old_table_m = table_m;
+    old_bucket_count_m = bucket_count_m;
+    migrated_m = 0;
+
+    table_m = _new_table(n);
+    bucket_count_m = n;
+  }
+
+  /**
+   * \brief Moves up to steps buckets of the old table to the new one,
+   * freeing the old table once it is empty.
+   */
+  void _migrate(size_type steps) {
+    if (old_table_m == NULL) {
+      return;
+    }
+
+    for (; steps > 0 && migrated_m < old_bucket_count_m; --steps, ++migrated_m) {
+      bucket_type& bucket = old_table_m[migrated_m];
+      for (typename bucket_type::iterator it = bucket.begin(); it != bucket.end(); ++it) {
+	table_m[_bucket(it->second->hash_m)].insert(*it);
+      }
+      bucket.clear();
+    }
+
+    if (migrated_m == old_bucket_count_m) {
+      _delete_table(old_table_m, old_bucket_count_m);
+      old_table_m = NULL;
+      old_bucket_count_m = 0;
+      migrated_m = 0;
+    }
+  }
+
+  /**
+   * \brief Fills this empty map, which has as many buckets as x, with
+   * copies of x's elements. Each bucket tree is cloned as is and its
+   * values pointed to fresh nodes, so nothing is hashed or compared.
+   * Elements still in x's old table during an incremental rehash are
+   * placed with their cached hash.
+   */
+  void _copy_buckets(const Self& x) {
+    for (size_type i = 0; i < bucket_count_m; ++i) {
+      if (x.table_m[i].empty()) {
+	continue;
+      }
+
+      const bucket_type& bucket = x.table_m[i];
+      table_m[i] = bucket;
+      typename bucket_type::const_iterator from = bucket.begin();
+      for (typename bucket_type::iterator to = table_m[i].begin();
+	   to != table_m[i].end(); ++to, ++from) {
+	Node* new_node = _new_node(from->second->value_m, from->second->hash_m);
+	_link_node(new_node);
+	to->second = new_node;
+	++size_m;
+      }
+    }
+
+    for (size_type i = x.migrated_m; i < x.old_bucket_count_m; ++i) {
+      const bucket_type& bucket = x.old_table_m[i];
+      for (typename bucket_type::const_iterator from = bucket.begin();
+	   from != bucket.end(); ++from) {
+	Node* new_node = _new_node(from->second->value_m, from->second->hash_m);
+	_link_node(new_node);
+	const pair<Key, Node*> keynodepair(from->first, new_node);
+	table_m[_bucket(new_node->hash_m)].insert(keynodepair);
+	++size_m;
+      }
+    }
+  }
+
+  /**
+   * \brief Drops every table and node without deleting them, after a move.
+   */
+  void _forget() {
+    table_m = NULL;
+    bucket_count_m = 0;
+    size_m = 0;
+    head_m = tail_m = NULL;
+    old_table_m = NULL;
+    old_bucket_count_m = 0;
+    migrated_m = 0;
+  }
+
+  /**
+   * \brief Exchanges two members, see swap().
+   */
+  template <class M>
+  static void _swap_member(M& a, M& b) {
+    M temp = a;
+    a = b;
+    b = temp;
+  }
+
+  /**
+   * \brief Appends a node to the list of all nodes.
+   */
+  void _link_node(Node* n) {
+    n->prev_m = tail_m;
+    n->next_m = NULL;
+    if (tail_m) {
+      tail_m->next_m = n;
+    } else {
+      head_m = n;
+    }
+    tail_m = n;
+  }
+
+  /**
+   * \brief Removes a node from the list of all nodes.
+   */
+  void _unlink_node(Node* n) {
+    if (n->prev_m) {
+      n->prev_m->next_m = n->next_m;
+    } else {
+      head_m = n->next_m;
+    }
+    if (n->next_m) {
+      n->next_m->prev_m = n->prev_m;
+    } else {
+      tail_m = n->prev_m;
+    }
+  }
+
+  /**
+   * \brief Allocates and builds a node from args.
+   */
+  template <class... Args>
+  Node* _new_node(Args&&... args) {
+    Node* n = alloc_m.allocate(1);
+    try {
+      ::new (static_cast<void*>(n)) Node(std::forward<Args>(args)...);
+    } catch (...) {
+      alloc_m.deallocate(n, 1);
+      throw;
+    }
+    return n;
+  }
+
+  /**
+   * \brief Destroys and frees a node from _new_node().
+   */
+  void _delete_node(Node* n) {
+    n->~Node();
+    alloc_m.deallocate(n, 1);
+  }
+
+  /**
+   * \brief Allocates an array of n empty buckets.
+   */
+  bucket_type* _new_table(size_type n) {
+    table_allocator table_alloc(alloc_m);
+    bucket_type* table = table_alloc.allocate(n);
+    for (size_type i = 0; i < n; ++i) {
+      ::new (static_cast<void*>(table + i)) bucket_type();
+    }
+    return table;
+  }
+
+  /**
+   * \brief Destroys and frees an array of n buckets from _new_table(),
+   * if table is not NULL.
+   */
+  void _delete_table(bucket_type* table, size_type n) {
+    if (table == NULL) {
+      return;
+    }
+
+    for (size_type i = 0; i < n; ++i) {
+      table[i].~bucket_type();
+    }
+    table_allocator table_alloc(alloc_m);
+    table_alloc.deallocate(table, n);
+  }
+
+  /**
+   * \brief Deletes every node, leaving the buckets to the caller.
+   */
+  void _delete_nodes() {
+    Node* curr = head_m;
+    while (curr) {
+      Node* next = curr->next_m;
+      _delete_node(curr);
+      curr = next;
+    }
+    head_m = tail_m = NULL;
   }
 };
 
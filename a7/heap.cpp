@@ -0,0 +1,376 @@
+/**
+ * \file heap.cpp
+ *
+ * Implementation of the cell heap and its mark-and-sweep collector.
+ */
+
+#include "heap.hpp"
+#include "eval.hpp"
+
+using namespace std;
+
+/**
+ * \struct HeapEntry
+ * \brief One allocation of the heap: a single cell, with the memory it
+ * owns, or a block of CompactConsCell allocated by heap_allocate_block().
+ */
+struct HeapEntry {
+  HeapEntry(Cell* cell, size_t bytes, size_t count)
+    : cell_m(cell), bytes_m(bytes), count_m(count) {}
+
+  Cell* cell_m;
+  // Including the bytes from heap_account_bytes().
+  size_t bytes_m;
+  // 0 for a single cell, else number of cells in the block.
+  size_t count_m;
+};
+
+// Every allocation of the heap.
+static vector<HeapEntry> heap_cells;
+
+// Cells registered through heap_add_root().
+static vector<Cell*> heap_roots;
+
+// Functions registered through heap_add_sweep_hook().
+static vector<void (*)()> heap_sweep_hooks;
+
+// Bytes held by heap_cells.
+static size_t heap_bytes_m = 0;
+
+// Bytes allocated since the previous collection.
+static size_t heap_allocated_since_collect = 0;
+
+// Collect once this many bytes were allocated since the previous collection.
+//   Grows with the live heap, so collections stay proportional to allocation.
+static size_t heap_collect_threshold = 1 << 20;
+static size_t const HEAP_MIN_COLLECT_THRESHOLD = 1 << 20;
+
+// Largest value of heap_bytes_m so far.
+static size_t heap_peak_bytes = 0;
+
+// Allocations fail beyond this many bytes, 0 for no limit.
+static size_t heap_max_bytes_m = 0;
+
+/**
+ * \enum HeapClass
+ * \brief enum HeapClass lists the Cell subclasses accounted separately
+ */
+enum HeapClass {
+  heap_int = 0,
+  heap_double,
+  heap_symbol,
+  heap_operator,
+  heap_cons,
+  heap_compact_cons,
+  heap_procedure,
+  heap_map,
+  heap_class_count
+};
+
+static const char* const heap_class_names[heap_class_count] = {
+  "IntCell",
+  "DoubleCell",
+  "SymbolCell",
+  "OperatorCell",
+  "ConsCell",
+  "CompactConsCell",
+  "ProcedureCell",
+  "MapCell"
+};
+
+// Cells and bytes reclaimed so far, by class.
+static size_t heap_freed_count[heap_class_count];
+static size_t heap_freed_bytes[heap_class_count];
+
+// True while the sweep is deleting cells.
+static bool heap_sweeping = false;
+
+/**
+ * \brief Enforces the heap limit before an allocation.
+ * \param size The size in bytes about to be allocated.
+ */
+static void heap_check_limit(size_t size)
+{
+  if (heap_max_bytes_m != 0 && heap_bytes_m + size > heap_max_bytes_m) {
+    stringstream ss;
+    ss << "Heap limit of " << heap_max_bytes_m << " bytes exceeded";
+    // Unwinds the current evaluation; its cells are reclaimed at the next
+    //   safe point.
+    throw_error(ss.str(), "heap.cpp::heap_allocate(size_t)");
+  }
+}
+
+/**
+ * \brief Records a new allocation of the heap.
+ * \param p The allocated memory.
+ * \param size The size in bytes of the allocation.
+ * \param count 0 for a single cell, else the number of cells in the block.
+ */
+static void heap_record(void* p, size_t size, size_t count)
+{
+  // Single inheritance from Cell: the allocated address is the Cell address.
+  heap_cells.push_back(HeapEntry(static_cast<Cell*>(p), size, count));
+  heap_bytes_m += size;
+  heap_allocated_since_collect += size;
+  if (heap_bytes_m > heap_peak_bytes) {
+    heap_peak_bytes = heap_bytes_m;
+  }
+}
+
+void* heap_allocate(size_t size)
+{
+  heap_check_limit(size);
+  void* p = ::operator new(size);
+  heap_record(p, size, 0);
+  return p;
+}
+
+void* heap_allocate_block(size_t size, size_t count)
+{
+  heap_check_limit(size);
+  void* p = ::operator new(size);
+  heap_record(p, size, count);
+  return p;
+}
+
+void heap_account_bytes(Cell* const owner, size_t size)
+{
+  heap_check_limit(size);
+
+  // The owner is under construction, so it is normally the last entry.
+  for (size_t i = heap_cells.size(); i > 0; --i) {
+    if (heap_cells[i - 1].cell_m == owner) {
+      heap_cells[i - 1].bytes_m += size;
+      heap_bytes_m += size;
+      heap_allocated_since_collect += size;
+      if (heap_bytes_m > heap_peak_bytes) {
+	heap_peak_bytes = heap_bytes_m;
+      }
+      break;
+    }
+  }
+}
+
+void heap_release(void* p)
+{
+  if (!heap_sweeping) {
+    // A constructor threw; forget the half-built cell.
+    for (size_t i = heap_cells.size(); i > 0; --i) {
+      if (heap_cells[i - 1].cell_m == p) {
+	heap_bytes_m -= heap_cells[i - 1].bytes_m;
+	heap_cells.erase(heap_cells.begin() + (i - 1));
+	break;
+      }
+    }
+  }
+  ::operator delete(p);
+}
+
+/**
+ * \brief Gets the class of a heap entry, for accounting.
+ * \param entry The heap entry.
+ * \return The class of its cells.
+ */
+static HeapClass heap_class(const HeapEntry& entry)
+{
+  if (entry.count_m != 0) {
+    return heap_compact_cons;
+  }
+
+  switch (entry.cell_m->get_tag()) {
+    case type_int: {
+      return heap_int;
+    }
+    case type_double: {
+      return heap_double;
+    }
+    case type_symbol: {
+      return heap_symbol;
+    }
+    case type_operator: {
+      return heap_operator;
+    }
+    case type_cons: {
+      return heap_cons;
+    }
+    case type_map: {
+      return heap_map;
+    }
+    default: {
+      return heap_procedure;
+    }
+  }
+}
+
+void heap_add_root(Cell* const c)
+{
+  heap_roots.push_back(c);
+}
+
+void heap_add_sweep_hook(void (*hook)())
+{
+  heap_sweep_hooks.push_back(hook);
+}
+
+/**
+ * \brief Marks every cell reachable from c.
+ * Uses an explicit stack so long lists cannot overflow the call stack.
+ * \param pending Scratch stack of cells still to be visited.
+ * \param c The cell to start from.
+ */
+static void heap_mark(vector<Cell*>& pending, Cell* const c)
+{
+  pending.push_back(c);
+
+  while (!pending.empty()) {
+    Cell* curr = pending.back();
+    pending.pop_back();
+
+    if (nullp(curr) || curr->is_marked()) {
+      continue;
+    }
+    curr->set_marked(true);
+
+    if (consp(curr)) {
+      pending.push_back(cdr(curr));
+      pending.push_back(car(curr));
+    } else if (procedurep(curr)) {
+      pending.push_back(get_formals(curr));
+      pending.push_back(get_body(curr));
+    } else if (mapp(curr)) {
+      const MapCell::ordered_map& entries = static_cast<MapCell*>(curr)->get_map();
+      for (MapCell::ordered_map::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+	pending.push_back(it->second.first);
+	pending.push_back(it->second.second);
+      }
+    }
+  }
+}
+
+void heap_collect()
+{
+  vector<Cell*> pending;
+
+  // Mark
+  for (size_t i = 0; i < heap_roots.size(); ++i) {
+    heap_mark(pending, heap_roots[i]);
+  }
+  for (size_t i = 0; i < stack_frame.size(); ++i) {
+    const hashmap& frame = stack_frame[i];
+    for (hashmap::const_iterator it = frame.begin(); it != frame.end(); ++it) {
+      heap_mark(pending, it->second);
+    }
+  }
+
+  for (size_t i = 0; i < heap_sweep_hooks.size(); ++i) {
+    heap_sweep_hooks[i]();
+  }
+
+  // Sweep
+  //   Compacts the survivors to the front of heap_cells.
+  heap_sweeping = true;
+  size_t kept = 0;
+  for (size_t i = 0; i < heap_cells.size(); ++i) {
+    const HeapEntry& entry = heap_cells[i];
+    bool reachable = false;
+
+    if (entry.count_m == 0) {
+      reachable = entry.cell_m->is_marked();
+      entry.cell_m->set_marked(false);
+    } else {
+      // A block is kept whole if any of its cells is reachable.
+      CompactConsCell* block = static_cast<CompactConsCell*>(entry.cell_m);
+      for (size_t j = 0; j < entry.count_m; ++j) {
+	reachable = reachable || block[j].is_marked();
+	block[j].set_marked(false);
+      }
+    }
+
+    if (reachable) {
+      heap_cells[kept++] = entry;
+      continue;
+    }
+
+    HeapClass type = heap_class(entry);
+    heap_freed_count[type] += entry.count_m == 0 ? 1 : entry.count_m;
+    heap_freed_bytes[type] += entry.bytes_m;
+    heap_bytes_m -= entry.bytes_m;
+
+    if (entry.count_m == 0) {
+      delete entry.cell_m;
+    } else {
+      CompactConsCell* block = static_cast<CompactConsCell*>(entry.cell_m);
+      for (size_t j = 0; j < entry.count_m; ++j) {
+	block[j].~CompactConsCell();
+      }
+      ::operator delete(block);
+    }
+  }
+  heap_cells.erase(heap_cells.begin() + kept, heap_cells.end());
+  heap_sweeping = false;
+
+  heap_allocated_since_collect = 0;
+  heap_collect_threshold = heap_bytes_m > HEAP_MIN_COLLECT_THRESHOLD ?
+    heap_bytes_m : HEAP_MIN_COLLECT_THRESHOLD;
+}
+
+void heap_maybe_collect()
+{
+  // Under a heap limit, also collect whenever half of it is in use, so
+  //   garbage left by earlier expressions does not count against the next.
+  if (heap_allocated_since_collect >= heap_collect_threshold
+      || (heap_max_bytes_m != 0 && heap_bytes_m > heap_max_bytes_m / 2)) {
+    heap_collect();
+  }
+}
+
+size_t heap_cell_count()
+{
+  return heap_cells.size();
+}
+
+size_t heap_bytes()
+{
+  return heap_bytes_m;
+}
+
+void heap_set_max_bytes(size_t max_bytes)
+{
+  heap_max_bytes_m = max_bytes;
+}
+
+size_t heap_max_bytes()
+{
+  return heap_max_bytes_m;
+}
+
+void heap_report(ostream& os)
+{
+  size_t live_count[heap_class_count];
+  size_t live_bytes[heap_class_count];
+  for (int i = 0; i < heap_class_count; ++i) {
+    live_count[i] = live_bytes[i] = 0;
+  }
+
+  for (size_t i = 0; i < heap_cells.size(); ++i) {
+    HeapClass type = heap_class(heap_cells[i]);
+    live_count[type] += heap_cells[i].count_m == 0 ? 1 : heap_cells[i].count_m;
+    live_bytes[type] += heap_cells[i].bytes_m;
+  }
+
+  os << left << setw(16) << "cell type"
+     << right << setw(12) << "live" << setw(14) << "live bytes"
+     << setw(12) << "allocated" << setw(16) << "allocated bytes" << endl;
+  for (int i = 0; i < heap_class_count; ++i) {
+    os << left << setw(16) << heap_class_names[i]
+       << right << setw(12) << live_count[i] << setw(14) << live_bytes[i]
+       << setw(12) << live_count[i] + heap_freed_count[i]
+       << setw(16) << live_bytes[i] + heap_freed_bytes[i] << endl;
+  }
+  os << "heap: " << heap_bytes_m << " bytes live, "
+     << heap_peak_bytes << " bytes peak";
+  if (heap_max_bytes_m != 0) {
+    os << ", " << heap_max_bytes_m << " bytes limit";
+  }
+  os << endl;
+}
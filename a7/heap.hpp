@@ -0,0 +1,118 @@
+/**
+ * \file heap.hpp
+ *
+ * Encapsulates the interface for the cell heap and its garbage collector.
+ *
+ * Ownership model: cells are immutable once constructed and may be shared
+ * freely, e.g. a variable reference returns the very cell stored in its
+ * frame. No cell owns another one; every cell is owned by the heap, which
+ * reclaims unreachable cells with a mark-and-sweep collection. Collection
+ * only happens at safe points between top-level expressions, where the
+ * stack frames and the registered roots are the only live references.
+ */
+
+#ifndef HEAP_HPP
+#define HEAP_HPP
+
+#include <cstddef>
+#include <iostream>
+
+using namespace std;
+
+class Cell;
+
+/**
+ * \brief Allocates memory for a new cell and records it in the heap.
+ * \param size The size in bytes of the cell to allocate.
+ * \return Pointer to uninitialized memory for the cell.
+ */
+void* heap_allocate(size_t size);
+
+/**
+ * \brief Allocates memory for a block of cells that live and die together,
+ * such as the cells of a CDR-coded list, and records it in the heap.
+ * The block stays alive as long as any one of its cells is reachable.
+ * \param size The size in bytes of the whole block.
+ * \param count The number of CompactConsCell in the block.
+ * \return Pointer to uninitialized memory for the block.
+ */
+void* heap_allocate_block(size_t size, size_t count);
+
+/**
+ * \brief Accounts for memory a cell owns besides its own body, such as
+ * the characters of a symbol, so that it counts against the heap limit
+ * and in the report. Call it from the cell's constructor, before
+ * allocating the memory; the bytes are released with the cell.
+ * \param owner The cell owning the memory, already allocated with
+ * heap_allocate().
+ * \param size The size in bytes of the memory.
+ */
+void heap_account_bytes(Cell* const owner, size_t size);
+
+/**
+ * \brief Releases the memory of a cell that never finished construction.
+ * Cells that were fully constructed are only ever released by the sweep.
+ * \param p Pointer previously returned by heap_allocate().
+ */
+void heap_release(void* p);
+
+/**
+ * \brief Registers a cell that must never be collected.
+ * \param c The cell to keep alive.
+ */
+void heap_add_root(Cell* const c);
+
+/**
+ * \brief Registers a function to run between the mark and the sweep of
+ * every collection, e.g. to drop weak references to unmarked cells.
+ * \param hook The function to run.
+ */
+void heap_add_sweep_hook(void (*hook)());
+
+/**
+ * \brief Marks every cell reachable from the roots, then deletes all
+ * unmarked cells. Must only be called between top-level expressions.
+ */
+void heap_collect();
+
+/**
+ * \brief Safe point: runs heap_collect() if enough memory has been
+ * allocated since the previous collection.
+ */
+void heap_maybe_collect();
+
+/**
+ * \brief Gets the number of cells currently held by the heap.
+ * \return The number of cells, reachable or not.
+ */
+size_t heap_cell_count();
+
+/**
+ * \brief Gets the number of bytes currently held by the heap.
+ * \return The number of bytes of cells and the memory they own,
+ * reachable or not.
+ */
+size_t heap_bytes();
+
+/**
+ * \brief Limits the bytes the heap may hold, counting the memory owned
+ * by cells. Past the limit, allocating a cell or its memory throws a
+ * runtime_error that aborts the current evaluation.
+ * \param max_bytes The limit in bytes, 0 for no limit.
+ */
+void heap_set_max_bytes(size_t max_bytes);
+
+/**
+ * \brief Gets the limit set by heap_set_max_bytes().
+ * \return The limit in bytes, 0 for no limit.
+ */
+size_t heap_max_bytes();
+
+/**
+ * \brief Prints, for each Cell subclass, the cells and bytes the heap
+ * holds (not yet collected) and has allocated in total.
+ * \param os The output stream to print to.
+ */
+void heap_report(ostream& os);
+
+#endif // HEAP_HPP
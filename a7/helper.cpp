@@ -31,9 +31,7 @@ void assert_cellnotnull(const string& what_arg, Cell* const c)
 
 void assert_isdoubleintcell(const string& what_arg, Cell* const c)
 {
-  try {
-    get_value(c);
-  } catch (runtime_error) {
+  if (!intp(c) && !doublep(c)) {
     throw_error(what_arg);
   }
 }
@@ -128,6 +128,12 @@
 	0)))
 
 (define equal? 
+  (lambda (obj1 obj2)
+    (if (eq? obj1 obj2)
+	1
+	(structural-equal? obj1 obj2))))
+
+(define structural-equal? 
   (lambda (obj1 obj2)
     (if (nullp obj1)
 	(if (nullp obj2)
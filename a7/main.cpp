@@ -10,32 +10,48 @@
 #include <stdexcept>
 #include "parse.hpp"
 #include "eval.hpp"
+#include "heap.hpp"
+#include "hashcons.hpp"
 #include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 
 /**
- * \brief Parse and evaluate the s-expression, and print the result.
- * \param sexpr The string vaule holding the s-expression.
+ * \brief Evaluate the parse tree, and print the result.
+ * \param root The root of the parse tree.
  */
-void parse_eval_print(string sexpr)
+void eval_print(Cell* root)
 {
   try {
-    Cell* root = parse(sexpr);
     Cell* result = eval(root);
     if ( result == nil ) {
       cout << "()" << endl;
     } else {
       cout << *result << endl;
     }
-    // delete root;
-    // delete result;
   } catch (runtime_error &e) {
     cerr << "ERROR: " << e.what() << endl;
   } catch (logic_error &e) {
     cerr << "LOGIC ERROR: " << e.what() << endl;
     exit(1);
   }
+
+  // Between top-level expressions the stack frames are the only roots,
+  //   so root and result can be reclaimed along with any other garbage.
+  heap_maybe_collect();
+}
+
+/**
+ * \brief Parse and evaluate the s-expression, and print the result.
+ * \param sexpr The string vaule holding the s-expression.
+ */
+void parse_eval_print(string sexpr)
+{
+  eval_print(parse(sexpr));
 }
 
 /**
@@ -142,11 +158,74 @@ void readfile(ifstream& fin)
 }
 
 /**
- * \brief Read the expressions from the file.
+ * \brief Read, parse, evaluate, and print the expressions one by one
+ * from the file, mapped into memory.  They are parsed in place, without
+ * copying the text.  An illegal s-expression is reported and handled as
+ * parse_eval_print() does, then reading goes on after it, so the same
+ * forms are evaluated as by readfile(ifstream&).
+ *
+ * \param fn The file name.
+ * \return False if the file cannot be mapped (it is not a regular file,
+ * or is empty), having read nothing.
+ */
+bool readfile_mapped(const char* fn)
+{
+  int fd = open(fn, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping stays valid once the file is closed
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  string_view text(static_cast<const char*>(data), size);
+  size_t pos = 0;
+  while (true) {
+    // skip the white space before the next s-expression
+    while (pos < size && iswhitespace(text[pos])) {
+      pos ++;
+    }
+    if (pos == size) {
+      break;
+    }
+
+    Cell* root;
+    try {
+      root = parse_next(text, pos);
+    } catch (runtime_error &e) {
+      // parse_next skipped the illegal s-expression; like parse(),
+      //   report it and go on with nil.
+      cout << "error: " << e.what() << endl;
+      root = nil;
+    }
+    // the parse tree holds copies of its symbols, not views of the text
+    eval_print(root);
+  }
+
+  munmap(data, size);
+  return true;
+}
+
+/**
+ * \brief Read the expressions from the file, mapped into memory if
+ * possible, else as a stream.
  * \param fn The file name.
  */
 void readfile(char* fn)
 {
+  if (readfile_mapped(fn)) {
+    return;
+  }
   ifstream fin(fn);
   readfile(fin);
   fin.close();
@@ -173,25 +252,104 @@ void readconsole()
   } while (true);
 }
 
+// True to print the heap statistics at exit.
+static bool heap_stats_on = false;
+
+/**
+ * \brief Parse a size in bytes, optionally suffixed with K, M or G.
+ * \param str The size.
+ * \return The number of bytes, 0 if str is not a valid size.
+ */
+size_t parse_size(const string& str)
+{
+  stringstream ss(str);
+  size_t size = 0;
+  ss >> size;
+  if (ss.fail()) {
+    return 0;
+  }
+
+  char unit = '\0';
+  ss >> unit;
+  switch (unit) {
+  // Each unit scales by 1024 and falls through to the next smaller one.
+  case 'G': case 'g':
+    size <<= 10;
+    // fall through
+  case 'M': case 'm':
+    size <<= 10;
+    // fall through
+  case 'K': case 'k':
+    size <<= 10;
+    // fall through
+  case '\0':
+    break;
+  default:
+    return 0;
+  }
+  return size;
+}
+
+/**
+ * \brief Print the statistics turned on by command-line options.
+ */
+void print_exit_report()
+{
+  if (heap_stats_on) {
+    // Report only what is still reachable as live.
+    heap_collect();
+    heap_report(cerr);
+  }
+  if (hashcons_enabled()) {
+    hashcons_report(cerr);
+  }
+}
+
 /**
  * \brief Call either the batch or interactive main drivers.
+ * Options: --hash-cons interns literals and quoted data,
+ * --heap-stats prints the heap usage per cell type at exit,
+ * --max-heap SIZE limits the heap, e.g. 64M (an evaluation needing more
+ * fails with an error).
  */
 int main(int argc, char* argv[])
 {
+  // Options may appear anywhere, the other arguments are input files.
+  vector<char*> files;
+  for (int i = 1; i < argc; ++i) {
+    if (string(argv[i]) == "--hash-cons") {
+      hashcons_enable(true);
+    } else if (string(argv[i]) == "--heap-stats") {
+      heap_stats_on = true;
+    } else if (string(argv[i]) == "--max-heap" && i + 1 < argc) {
+      size_t max_bytes = parse_size(argv[++i]);
+      if (max_bytes == 0) {
+	cerr << "invalid heap size: " << argv[i] << endl;
+	exit(1);
+      }
+      heap_set_max_bytes(max_bytes);
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+
   readfile("library.scm");
-  switch(argc) {
-  case 1:
+  switch(files.size()) {
+  case 0:
     // read from the standard input
     readconsole();
+    print_exit_report();
     exit(0);
     break;
-  case 2:
+  case 1:
     // read from a file
-    readfile(argv[1]);
+    readfile(files[0]);
     break;
   default:
     cout << "too many arguments!" << endl;
     exit(0);
   }
+
+  print_exit_report();
   return 0;
 }
@@ -2,11 +2,16 @@
  * \file parse.cpp
  *
  * Implementation of a parser that analyzes a string containing an
- * s-expression, and determines its tree structure.
+ * s-expression, and determines its tree structure. It makes a single
+ * pass over the text: a recursive descent that reads each token as a
+ * string_view into the text, and builds each list straight into a
+ * CDR-coded block once its closing parenthesis is reached.
  */
 
 #include "parse.hpp"
-bool inparsecar;
+#include "hashcons.hpp"
+#include <stdexcept>
+
 // check whether chr is white space
 bool iswhitespace(char ch)
 {
@@ -23,7 +28,7 @@ bool iswhitespace(char ch)
  * \param str The string to be checked
  * \return ture if numericstr is an legal numericstr string, false otherwise
  */
-bool is_legalnumeric(string str) 
+bool is_legalnumeric(string_view str) 
 {
   int dotnum = 0;
   int length = str.length();
@@ -47,334 +52,236 @@ bool is_legalnumeric(string str)
 }
 
 /**
- * \brief Check whether str is a legal operator
- * 
+ * \brief Make the cell. When hash-consing is on, numeric literals are
+ * interned.
+ * \param str The token to represent the symbol, int or double.
  */
-bool is_legaloperator(string str)
+Cell* makecell(string_view str)
 {
-  return true;
+  Cell* root;
+  if (((str[0] >= '0') && (str[0] <= '9')) || (str[0] == '.') 
+      || ((('+'==str[0]) || ('-'==str[0]))&&(str.length()>1))) {
+    if (false == is_legalnumeric(str)) {
+      cout << "error: illegal numeric literal" << endl;
+      exit(1);
+    }
+    // this is a numeric literal; atoi and atof need it terminated.
+    string literal(str);
+    if (string_view::npos == str.find('.')) {
+      // int number
+      root = make_int(atoi(literal.c_str()));
+    } else {
+      // this is a double
+      root = make_double(atof(literal.c_str()));
+    }
+    if (hashcons_enabled()) {
+      root = hashcons(root);
+    }
+  } else {
+    // this is a symbol; literal strings are kept as symbols, quotes included.
+    root = make_symbol(string(str).c_str());
+  }
+  return root;
+}
+
+/**
+ * \struct ParseCursor
+ * \brief The state of a parse: the text, the position reached in it, and
+ * the elements read so far of the lists still open, innermost last.
+ */
+struct ParseCursor {
+  ParseCursor(string_view text, size_t pos) : text_m(text), pos_m(pos) {}
+
+  string_view text_m;
+  size_t pos_m;
+  vector<Cell*> elems_m;
+};
+
+/**
+ * \brief Signal a malformed s-expression.
+ */
+static void illegal_expr()
+{
+  throw runtime_error("illegal s-expression ");
 }
 
-void readsinglesymbol(string& substring, string& sexpr)
+/**
+ * \brief Skip the whitespace at the cursor.
+ * \return True iff text remains after it.
+ */
+static bool skip_whitespace(ParseCursor& cursor)
 {
-  char currentchar;
-  int i = 0;
-  int length = substring.length();
+  while (cursor.pos_m < cursor.text_m.size() && iswhitespace(cursor.text_m[cursor.pos_m])) {
+    ++cursor.pos_m;
+  }
+  return cursor.pos_m < cursor.text_m.size();
+}
 
-  // get the first character
-  currentchar = substring[i];
+/**
+ * \brief Read the token at the cursor: a string literal with its quotes,
+ * or else the characters up to whitespace, a parenthesis or a quote.
+ * \return The token, a view into the text.
+ */
+static string_view read_token(ParseCursor& cursor)
+{
+  const string_view& text = cursor.text_m;
+  size_t start = cursor.pos_m;
 
-  if (currentchar == '\"') {
-    // read a string literal
-    sexpr += currentchar;
-    do {
-      ++i;
-      currentchar = substring[i];
-      sexpr += currentchar;
-    } while (currentchar != '\"' && i < length-1);
-    if ('\"' != currentchar) {
-      cout << "error: illegal string" << endl;
-      exit(1);
+  if ('\"' == text[start]) {
+    size_t close = text.find('\"', start + 1);
+    if (string_view::npos == close) {
+      illegal_expr();
     }
+    cursor.pos_m = close + 1;
   } else {
-    // read a numeric literal or operator
-    do {
-      sexpr += currentchar;
-      ++i;
-      if (i >= static_cast<int>(substring.size())) {
-	break;
-      }
-      currentchar = substring[i];
-    } while ((!iswhitespace(currentchar)) && (currentchar != '(') && currentchar != '\"');
-    --i;
+    size_t end = start;
+    while (end < text.size() && !iswhitespace(text[end])
+	   && '(' != text[end] && ')' != text[end] && '\"' != text[end]) {
+      ++end;
+    }
+    cursor.pos_m = end;
   }
-  substring = substring.substr(i+1, length - i - 1);
+
+  return text.substr(start, cursor.pos_m - start);
 }
 
+static Cell* parse_expr(ParseCursor& cursor);
 
 /**
- * \brief Clear the whitespace at the begining and end of string sexpr.
- * \param sexpr The string.
+ * \brief Parse the elements of a list up to its closing parenthesis, the
+ * cursor being just past the opening one. When hash-consing is on, the
+ * datum of a quote form is interned.
+ * \return The list as one CDR-coded block, nil if empty.
  */
-void clearwhitespace(string& sexpr)
+static Cell* parse_list(ParseCursor& cursor)
 {
-  if (sexpr.size() <= 0) {
-    return;
-  }
-  int leftvalidpos;
-  int rightvalidpos;
-  int length = sexpr.size();
-  int i;
-  // most left non-whitespace position
-  for (i = 0; i < length; ++i) {
-    if (iswhitespace(sexpr[i])) {
-      continue;
-    } else {
-      leftvalidpos = i;
+  vector<Cell*>& elems = cursor.elems_m;
+  size_t first = elems.size();
+
+  while (true) {
+    if (!skip_whitespace(cursor)) {
+      // no closing parenthesis
+      illegal_expr();
+    }
+    if (')' == cursor.text_m[cursor.pos_m]) {
+      ++cursor.pos_m;
       break;
     }
+    Cell* elem = parse_expr(cursor);
+    elems.push_back(elem);
   }
 
-  // most right non-whitespace position
-  for (i = length - 1; i >= 0; i --) {
-    if (iswhitespace(sexpr[i])) {
-      continue;
-    } else {
-      rightvalidpos = i;
-      break;
-    }
+  size_t length = elems.size() - first;
+  if (hashcons_enabled() && length == 2 && symbolp(elems[first])
+      && get_operation(get_symbol(elems[first])) == quote_opr) {
+    // (quote datum)
+    elems[first + 1] = hashcons(elems[first + 1]);
   }
 
-  // delete the white space at the beginning and end
-  if ( i == -1 ) sexpr = "";
-  else sexpr  =  sexpr.substr(leftvalidpos, rightvalidpos - leftvalidpos + 1);
+  Cell* list = make_list(length > 0 ? &elems[first] : NULL, length);
+  elems.resize(first);
+  return list;
 }
 
 /**
- * \brief Check whether the s-expression legal
+ * \brief Parse the s-expression at the cursor, which is not whitespace.
+ * \return The root of its tree.
  */
-bool is_legalexpr(string sexpr)
+static Cell* parse_expr(ParseCursor& cursor)
 {
-  clearwhitespace(sexpr);
-  if (sexpr.length()==0) {
-    cout << "blank string " << endl;
-    return false;
-  }
-  if (')' == sexpr[0]) {
-    cout << "error: illegal s-expression" << endl;
-    return false;
+  char currentchar = cursor.text_m[cursor.pos_m];
+
+  if ('(' == currentchar) {
+    ++cursor.pos_m;
+    return parse_list(cursor);
+  } else if (')' == currentchar) {
+    illegal_expr();
   }
-  if ('(' == sexpr[0]) {
-    // it is expression
-    int length = sexpr.length();
-    int inumleftparenthesis = 1;
-    int i;
-    int quotationmark = 0;
-    for (i = 1; i < length; i ++ ) {
-      if ('\"' == sexpr[i]) {
-        quotationmark ++;
-        quotationmark = quotationmark%2;
-      } else if ('(' == sexpr[i] && 0 == quotationmark) {
-        inumleftparenthesis ++;
-      } else if (')' == sexpr[i] && 0 == quotationmark) {
-        inumleftparenthesis --;
-      }
-      if (0 == inumleftparenthesis) {
-        break;
+  return makecell(read_token(cursor));
+}
+
+/**
+ * \brief Find the end of the top-level s-expression starting at start,
+ * delimited as the stream reader of main.cpp does: a list by counting
+ * parentheses, a string literal by its closing quote, and any other
+ * token by white space or an opening parenthesis.
+ * \param text The text holding the s-expression.
+ * \param start The position of its first character, not white space.
+ * \return The position just past it, at least start + 1.
+ */
+static size_t skip_form(string_view text, size_t start)
+{
+  size_t end = start + 1;
+
+  if ('(' == text[start]) {
+    int depth = 1;
+    while (end < text.size() && depth > 0) {
+      if ('(' == text[end]) {
+	depth ++;
+      } else if (')' == text[end]) {
+	depth --;
       }
+      end ++;
     }
-    if ((i < length - 1) || (i == length) || (inumleftparenthesis > 0) || 0 != quotationmark) {
-      cout << "error: illegal s-expression " << endl;
-      return false;
-    }
-  } else if ('\"' != sexpr[0]) {
-    // single element
-    if (string::npos != sexpr.find('(') || string::npos != sexpr.find(')') || string::npos != sexpr.find(' ') || string::npos != sexpr.find('\"'))  {
-      cout << "error: illegal s-expression " << endl;
-      return false;
-    }
-    // check whether str is illegal numeric literal or illegal operator
-    if ((false == is_legalnumeric(sexpr)) && (false ==is_legaloperator(sexpr))) {
-      cout << "error: illegal numeric literal or illegal operator" << endl;
-      return false;
-    }
+  } else if ('\"' == text[start]) {
+    size_t close = text.find('\"', end);
+    end = (string_view::npos == close) ? text.size() : close + 1;
   } else {
-    int length = sexpr.length();
-    int inumleft = 1;
-    int i;
-    for (i = 1; i < length; i ++) {
-      if ('\"' == sexpr[i]) {
-        inumleft ++;
-      }
-      if (2 == inumleft) {
-        break;
-      }
-    }
-    if ((i < length-1) || (inumleft != 2)) {
-      cout << "error: illegal s-expression " << endl;
-      return false;
+    while (end < text.size() && !iswhitespace(text[end]) && '(' != text[end]) {
+      end ++;
     }
   }
-  return true;
+  return end;
 }
 
 /**
- * \brief Make the cell.
- * \param str The string to represent the symbol, int or double.
+ * \brief Parse the s-expression at the cursor, which is not whitespace,
+ * up to the end of the cursor's text.
+ * \return The root of its tree.
  */
-Cell* makecell(string str)
+static Cell* parse_form(ParseCursor& cursor)
 {
-  Cell* root;
-  if (((str[0] >= '0') && (str[0] <= '9')) || (str[0] == '.') 
-      || ((('+'==str[0]) || ('-'==str[0]))&&(str.length()>1))) {
-    if (false == is_legalnumeric(str)) {
-      cout << "error: illegal numeric literal" << endl;
-      exit(1);
-    }
-    // this is a numeric literal
-    if (string::npos == str.find('.')) {
-      // int number
-      char* fchar = const_cast<char*>(str.c_str());
-      int value = atoi(fchar);
-      root = make_int(value);
-    } else {
-      // this is a double
-      char* fchar = const_cast<char*>(str.c_str());
-      double value = atof(fchar);   
-      root = make_double(value);
-    }
-  } 
-  
-  // we don't deal with literal strings right now, so they are commented out
-  // else if (str[0] == '\"') {
-//     // this is a string literal
-//     string strval = str.substr(1, str.size() - 2);
-//     root = make_string(const_cast<char*>(strval.data()));
-//   } 
-  else {
-    // this is a symbol
-    if (false == is_legaloperator(str)) {
-      cout << "error: illegal operator" << endl;
-      exit(1);
-    }
-    root = make_symbol(const_cast<char*>(str.data()));
+  if (')' == cursor.text_m[cursor.pos_m]) {
+    // a stray closing parenthesis
+    throw runtime_error("illegal s-expression");
+  }
+
+  Cell* root = parse_expr(cursor);
+  // nothing may follow the s-expression
+  if (skip_whitespace(cursor)) {
+    illegal_expr();
   }
   return root;
 }
 
-Cell* separate_parse(string& sexpr); 
-
-Cell* parse(string sexpr)
+Cell* parse_next(string_view text, size_t& pos)
 {
-  // is_legal(sexpr);
-  // delete the whitesapce at the begining and end
-  // such that the first and last character are not white space
-  clearwhitespace(sexpr);
-//   if (sexpr.length() == 0) {
-//     return NULL;
-//   }
-  if (sexpr.length() == 0) {
-    return NULL;
-  }
-  if ( !is_legalexpr(sexpr)) {
-    return NULL;
-  }
-  // check whether is single symbol
-  // i.e. leaf cell
-  // if (string::npos == sexpr.find('(')) {
-  if ('(' != sexpr[0]) {
-    // this is leaf cell
-    // bulid this leaf cell
-    Cell* root = makecell( sexpr );
-    return root;
-  }
+  ParseCursor cursor(text, pos);
 
-  // the first and last character are '(' and ')', respectively
-  // delete the two characters
-  int length = sexpr.size();
-  sexpr = sexpr.substr(1, length-2);
-  clearwhitespace(sexpr);
-  length = sexpr.size();
-//   if ( inparsecar ) {
-//     if (sexpr == "") {
-//       Cell* ec = new Cell("()");
-//       return ec;
-//     }
-//   }
-  // separate the s-expression into two left and right subsexps
-  Cell* root = separate_parse(sexpr);
+  if (!skip_whitespace(cursor)) {
+    pos = cursor.pos_m;
+    return nil;
+  }
+  pos = skip_form(text, cursor.pos_m);
 
-  return root;
+  // parse only the form's text, so that the forms and errors are those
+  //   of the stream reader, which hands each form to parse().
+  ParseCursor form(text.substr(0, pos), cursor.pos_m);
+  return parse_form(form);
 }
 
-/**
- * \brief Separately parse the sexpr and build the tree.
- * \param instr The string which consists of s-expressions.
- * \return A pointer to the conspair cell at the root of the parse tree.
- */
-Cell* separate_parse(string& instr)
+Cell* parse(string sexpr)
 {
-  string sexp;
-  bool isstartsexp = false;
-  int inumleftparenthesis = 0;
-
-  // check whether to read the end
-  clearwhitespace(instr);
-  int length = instr.size();
-    // check whether it is a "()" sexpr
-
-  while (instr.size() > 0) {
-    // read char by char
-    char currentchar = instr[0];
-    // skip some white space before new s-expression occurs
-    if ((true == iswhitespace(currentchar))&&(false == isstartsexp)) {
-      continue;
-    }
-    // run accross a new s-expression
-    if ((false == isstartsexp)&&(false == iswhitespace(currentchar))) {
-      // check whether single symbol
-      if ('(' != currentchar) {
-	// read single a single symbol
-	readsinglesymbol(instr, sexp);
-	clearwhitespace(instr);  
-	inparsecar = true;
-	Cell* car = parse(sexp);
-	inparsecar = false;
-	Cell* cdr = parse("(" + instr + ")");
-	Cell* root = cons(car, cdr);
-	sexp.clear();
-	return root;
-      } else {
-	// start new expression
-	isstartsexp = true;
-	// read left parenthesiss
-	sexp += currentchar;
-	instr = instr.substr(1, instr.size() -1);
-	inumleftparenthesis = 1;
-      }
-    } else {
-      // in the process of reading the current s-expression
-      if (true == isstartsexp) {
-	if (true == iswhitespace(currentchar)) {
-	  // append a blankspace
-	  sexp += ' ';
-	  instr = instr.substr(1, instr.size() -1);
-	} else {
-	  // append current character
-	  sexp += currentchar;
-	  instr = instr.substr(1, instr.size() -1);
-	  // count left parenthesiss
-	  if ('(' == currentchar) {
-	    inumleftparenthesis ++;
-	  }
-	  if (')' == currentchar) {
-	    inumleftparenthesis --;
+  ParseCursor cursor(sexpr, 0);
 
-	    // check whether current s-expression ends
-	    if (0 == inumleftparenthesis) {
-	      // current s-expression ends
-	      isstartsexp = false;
-	      clearwhitespace(instr);
-	      inparsecar = true;
-	      Cell* car = parse(sexp);        
-	      inparsecar = false;
-	      int length = instr.length();
-	      Cell* cdr;
-	      Cell* root;
-	      if (length <= 0) {
-		cdr = NULL;
-	      } else {
-		cdr = parse("(" + instr + ")");       
-	      }
-	      root = cons(car, cdr);
-	      sexp.clear();
-	      return root;     
-	    }
-	  }
-	}
-      }
-    }
+  if (!skip_whitespace(cursor)) {
+    return nil;
   }
 
-  return NULL;
+  try {
+    return parse_form(cursor);
+  } catch (runtime_error& e) {
+    cout << "error: " << e.what() << endl;
+    return nil;
+  }
 }
@@ -10,19 +10,33 @@
 #define PARSE_HPP
 
 #include "cons.hpp"
+#include <string_view>
 
 using namespace std;
 
 /**
- * \brief Recursively parse sexpr and build the parse tree.  \param
- * sexpr The s-expression stored in a string variable (note that this
- * version of parse has side effects: it may alter the contents of
- * sexpr).
+ * \brief Parse sexpr and build the parse tree.  \param sexpr The
+ * s-expression stored in a string variable.  Errors are reported on
+ * cout.
  *
- * \return A pointer to the conspair cell at the root of the parse tree.
+ * \return A pointer to the conspair cell at the root of the parse
+ * tree, nil if sexpr is empty or illegal.
  */
 Cell* parse(string sexpr);
 
+/**
+ * \brief Parse the next s-expression in text, starting at pos. The
+ * s-expressions are delimited as the stream reader of main.cpp does, by
+ * counting parentheses, then each is parsed as by parse().
+ * \param text The text holding the s-expressions; tokens are read in
+ * place, so it need not be a string.
+ * \param pos The position to start at; it is advanced past the
+ * s-expression, legal or not, or to the end of text if there is none.
+ * \return The root of the parse tree, nil if only whitespace is left.
+ * \throw runtime_error If the s-expression is illegal.
+ */
+Cell* parse_next(string_view text, size_t& pos);
+
 /**
  * \brief Check whether the character is whitespace.
  * \return True if it is character, false else.
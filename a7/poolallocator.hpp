@@ -0,0 +1,317 @@
+#ifndef POOLALLOCATOR_HPP
+#define POOLALLOCATOR_HPP
+
+/**
+ * \file poolallocator.hpp
+ *
+ * Creates a pool_allocator: the default allocator of the map nodes and
+ * bucket arrays. Small blocks are recycled through free lists, one per
+ * size class, instead of going back to malloc, so maps built and
+ * destroyed over and over (the stack frames) reuse the same memory.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+using namespace std;
+
+/**
+ * \class node_pool
+ * \brief Free lists of small blocks, in size classes of POOL_GRANULARITY
+ * bytes up to POOL_MAX_BLOCK. Each thread has its own free lists, so no
+ * locking is needed; a block freed by another thread than the one that
+ * allocated it simply joins the freeing thread's list. When a thread
+ * exits, its free lists go to shared, locked lists, from which the other
+ * threads refill before carving a new chunk, so threads coming and going
+ * do not grow the pool. Chunks are never given back to the system.
+ */
+class node_pool
+{
+public:
+  size_t static const POOL_GRANULARITY = 16;
+  size_t static const POOL_MAX_BLOCK = 1024;
+  size_t static const POOL_CHUNK_SIZE = 16384;
+
+  /**
+   * \brief Allocates a block of at least size bytes.
+   */
+  static void* allocate(size_t size)
+  {
+    if (size > POOL_MAX_BLOCK) {
+      return ::operator new(size);
+    }
+
+    FreeBlock*& free_list = _free_list(size);
+    if (free_list == NULL) {
+      _refill(free_list, _class_size(size));
+    }
+
+    FreeBlock* block = free_list;
+    free_list = block->next_m;
+    return block;
+  }
+
+  /**
+   * \brief Recycles a block from allocate(size).
+   */
+  static void deallocate(void* p, size_t size)
+  {
+    if (p == NULL) {
+      return;
+    }
+
+    if (size > POOL_MAX_BLOCK) {
+      ::operator delete(p);
+      return;
+    }
+
+    FreeBlock*& free_list = _free_list(size);
+    if (free_list == NULL) {
+      // may be this thread's first block
+      _register_thread();
+    }
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+    block->next_m = free_list;
+    free_list = block;
+  }
+
+private:
+  /**
+   * \struct FreeBlock
+   * \brief A free block, linked through its own first bytes.
+   */
+  struct FreeBlock {
+    FreeBlock* next_m;
+  };
+
+  /**
+   * \struct Chunk
+   * \brief Header of a chunk carved into blocks of one size class.
+   */
+  struct alignas(POOL_GRANULARITY) Chunk {
+    Chunk* next_m;
+  };
+
+  /**
+   * \brief Rounds size up to its size class.
+   */
+  static size_t _class_size(size_t size)
+  {
+    if (size == 0) {
+      size = 1;
+    }
+    return (size + POOL_GRANULARITY - 1) / POOL_GRANULARITY * POOL_GRANULARITY;
+  }
+
+  size_t static const POOL_CLASSES = POOL_MAX_BLOCK / POOL_GRANULARITY;
+
+  /**
+   * \struct SharedLists
+   * \brief Free lists given back by the threads that exited.
+   */
+  struct SharedLists {
+    mutex lock_m;
+    FreeBlock* free_lists_m[POOL_CLASSES];
+  };
+
+  /**
+   * \struct ThreadExit
+   * \brief Gives the free lists of its thread back when destroyed.
+   */
+  struct ThreadExit {
+    ~ThreadExit()
+    {
+      _give_back();
+    }
+  };
+
+  /**
+   * \brief Returns this thread's free lists, one per size class. Plain
+   * storage, so that maps destroyed after the thread's ThreadExit can
+   * still free their blocks.
+   */
+  static FreeBlock** _free_lists()
+  {
+    static thread_local FreeBlock* free_lists[POOL_CLASSES];
+    return free_lists;
+  }
+
+  /**
+   * \brief Returns this thread's free list for blocks of size bytes.
+   */
+  static FreeBlock*& _free_list(size_t size)
+  {
+    return _free_lists()[_class_size(size) / POOL_GRANULARITY - 1];
+  }
+
+  /**
+   * \brief Arranges for this thread's free lists to be given back when it
+   * exits.
+   */
+  static void _register_thread()
+  {
+    static thread_local ThreadExit on_exit;
+    (void) on_exit;
+  }
+
+  /**
+   * \brief Moves this thread's free lists to the shared ones.
+   */
+  static void _give_back()
+  {
+    FreeBlock** free_lists = _free_lists();
+    SharedLists& shared = _shared();
+    for (size_t i = 0; i < POOL_CLASSES; ++i) {
+      if (free_lists[i] == NULL) {
+	continue;
+      }
+      FreeBlock* last = free_lists[i];
+      while (last->next_m != NULL) {
+	last = last->next_m;
+      }
+
+      lock_guard<mutex> lock(shared.lock_m);
+      last->next_m = shared.free_lists_m[i];
+      shared.free_lists_m[i] = free_lists[i];
+      free_lists[i] = NULL;
+    }
+  }
+
+  /**
+   * \brief Moves up to count blocks of block_size bytes from the shared
+   * free lists onto an empty free list.
+   * \return False if there were none.
+   */
+  static bool _take_shared(FreeBlock*& free_list, size_t block_size, size_t count)
+  {
+    SharedLists& shared = _shared();
+    lock_guard<mutex> lock(shared.lock_m);
+    FreeBlock*& shared_list = shared.free_lists_m[block_size / POOL_GRANULARITY - 1];
+    if (shared_list == NULL) {
+      return false;
+    }
+
+    FreeBlock* last = shared_list;
+    for (size_t i = 1; i < count && last->next_m != NULL; ++i) {
+      last = last->next_m;
+    }
+    free_list = shared_list;
+    shared_list = last->next_m;
+    last->next_m = NULL;
+    return true;
+  }
+
+  /**
+   * \brief Refills an empty free list with blocks of block_size bytes,
+   * from the shared free lists if they have any, else by carving a new
+   * chunk.
+   */
+  static void _refill(FreeBlock*& free_list, size_t block_size)
+  {
+    _register_thread();
+
+    size_t count = (POOL_CHUNK_SIZE - sizeof(Chunk)) / block_size;
+    if (_take_shared(free_list, block_size, count)) {
+      return;
+    }
+
+    char* memory = static_cast<char*>(::operator new(sizeof(Chunk) + count * block_size));
+
+    // keep the chunk reachable, from any thread.
+    Chunk* chunk = reinterpret_cast<Chunk*>(memory);
+    atomic<Chunk*>& chunks = _chunks();
+    chunk->next_m = chunks.load(memory_order_relaxed);
+    while (!chunks.compare_exchange_weak(chunk->next_m, chunk, memory_order_release,
+					 memory_order_relaxed)) {
+    }
+
+    char* first = memory + sizeof(Chunk);
+    for (size_t i = count; i > 0; --i) {
+      FreeBlock* block = reinterpret_cast<FreeBlock*>(first + (i - 1) * block_size);
+      block->next_m = free_list;
+      free_list = block;
+    }
+  }
+
+  /**
+   * \brief Returns the shared free lists, never destroyed so that threads
+   * exiting after main can still give theirs back.
+   */
+  static SharedLists& _shared()
+  {
+    static SharedLists* shared = new SharedLists();
+    return *shared;
+  }
+
+  /**
+   * \brief Returns the list of every chunk allocated, never destroyed so
+   * that maps destroyed at exit can still recycle their blocks.
+   */
+  static atomic<Chunk*>& _chunks()
+  {
+    static atomic<Chunk*>* chunks = new atomic<Chunk*>(NULL);
+    return *chunks;
+  }
+};
+
+/**
+ * \class pool_allocator
+ * \brief Allocator drawing from the node_pool. Stateless: every
+ * pool_allocator can free what another one allocated.
+ */
+template <class T>
+class pool_allocator
+{
+public:
+  typedef T         value_type;
+  typedef T*        pointer;
+  typedef const T*  const_pointer;
+  typedef T&        reference;
+  typedef const T&  const_reference;
+  typedef size_t    size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <class U>
+  struct rebind {
+    typedef pool_allocator<U> other;
+  };
+
+  pool_allocator() {}
+
+  template <class U>
+  pool_allocator(const pool_allocator<U>&) {}
+
+  /**
+   * \brief Allocates room for n objects of type T, without constructing them.
+   */
+  T* allocate(size_t n)
+  {
+    static_assert(alignof(T) <= node_pool::POOL_GRANULARITY,
+		  "pool_allocator cannot align T");
+    return static_cast<T*>(node_pool::allocate(n * sizeof(T)));
+  }
+
+  /**
+   * \brief Frees room for n objects from allocate(n).
+   */
+  void deallocate(T* p, size_t n)
+  {
+    node_pool::deallocate(p, n * sizeof(T));
+  }
+
+  template <class U>
+  friend bool operator==(const pool_allocator&, const pool_allocator<U>&)
+  {
+    return true;
+  }
+
+  template <class U>
+  friend bool operator!=(const pool_allocator&, const pool_allocator<U>&)
+  {
+    return false;
+  }
+};
+
+#endif // POOLALLOCATOR_HPP